@@ -0,0 +1,139 @@
+// lookup_bench.c
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "constants.h"
+#include "first_pass/dictionary.h"
+#include "second_pass/binseq_hashmap.h"
+#include "read_file/read_file.h"
+
+/**
+ * Looks up every (position, length) slice of data in the records map of dict, the
+ * probes a map-based parse makes, so the filter statistics cover the misses of real
+ * input. Slices whose length no entry starting with their first byte has are skipped.
+ * @param batched Look up the slices ending at a position with one binseq_map_get_batch
+ *                call instead of one lookup each
+ * @param probes Receives the number of lookups made
+ * @return The number of slices skipped
+ */
+static size_t probeDictionary(const Dictionary* dict, const uint8_t* data, size_t size,
+                              bool batched, size_t* probes) {
+    const uint8_t* keys[SEQ_LENGTH_LIMIT];
+    uint16_t lens[SEQ_LENGTH_LIMIT];
+    const SequenceRecord* records[SEQ_LENGTH_LIMIT];
+    size_t skipped = 0;
+    *probes = 0;
+    for (size_t offset = 0; offset < size; offset += BLOCK_SIZE) {
+        uint32_t block_size = (uint32_t)MIN((size_t)BLOCK_SIZE, size - offset);
+        const uint8_t *block = data + offset;
+        for (uint32_t end = SEQ_LENGTH_START; end <= block_size; end++) {
+            size_t count = 0;
+            for (uint16_t len = SEQ_LENGTH_START; len <= SEQ_LENGTH_LIMIT && len <= end; len++) {
+                uint32_t start = end - len;
+                if (!dictionary_may_match(dict, block[start], len)) {
+                    skipped++;
+                    continue;
+                }
+                if (batched) {
+                    keys[count] = block + start;
+                    lens[count] = len;
+                } else {
+                    binseq_map_get_record(dict->records, block + start, len);
+                }
+                count++;
+            }
+            if (batched) {
+                binseq_map_get_batch(dict->records, keys, lens, records, count);
+            }
+            *probes += count;
+        }
+    }
+    return skipped;
+}
+
+static double secondsSince(const struct timespec* start) {
+    struct timespec now;
+    timespec_get(&now, TIME_UTC);
+    return (double)(now.tv_sec - start->tv_sec) + (now.tv_nsec - start->tv_nsec) / 1e9;
+}
+
+/**
+ * Replays the dictionary lookups of input_file against the records map: one at a
+ * time, batched, then with the map counting its probes. The dictionary is loaded
+ * from dict_file, or trained on the input the way compress does without one.
+ */
+static int benchFile(const char* input_file, const char* dict_file) {
+    size_t size = 0;
+    uint8_t *data = readWholeFile(input_file, &size);
+    if (!data) {
+        return 1;
+    }
+
+    Dictionary *dict;
+    if (dict_file) {
+        dict = dictionary_load(dict_file);
+    } else {
+        const uint8_t *samples[1] = {data};
+        dict = dictionary_train_suffix_array(samples, &size, 1, false);
+    }
+    if (!dict) {
+        fprintf(stderr, "Error: No dictionary available\n");
+        free(data);
+        return 1;
+    }
+
+    if (!dictionary_build_records(dict)) {
+        fprintf(stderr, "Error: Unable to build the records map\n");
+        dictionary_free(dict);
+        free(data);
+        return 1;
+    }
+
+    // Most probes miss; the filter answers those without touching the table
+    if (!binseq_map_build_filter(dict->records, DICT_FILTER_BITS_PER_KEY)) {
+        fprintf(stderr, "Warning: No memory for the records filter\n");
+    }
+
+    struct timespec start;
+    size_t probes;
+    timespec_get(&start, TIME_UTC);
+    size_t skipped = probeDictionary(dict, data, size, false, &probes);
+    double single = secondsSince(&start);
+    printf("Length masks: %d of %d lengths present, %zu probes skipped\n",
+           __builtin_popcountll(dict->lengths_present),
+           SEQ_LENGTH_LIMIT - SEQ_LENGTH_START + 1, skipped);
+    binseq_map_print_filter_stats(dict->records, "records");
+
+    // Same probes again, the lengths ending at each position as one batch
+    timespec_get(&start, TIME_UTC);
+    probeDictionary(dict, data, size, true, &probes);
+    double batched = secondsSince(&start);
+    printf("Lookup replay: %zu probes, %.1f ns each one by one, %.1f ns each batched\n",
+           probes, probes ? single * 1e9 / probes : 0.0, probes ? batched * 1e9 / probes : 0.0);
+
+    // Once more with the map counting, outside the timed replays
+    if (binseq_map_enable_stats(dict->records)) {
+        probeDictionary(dict, data, size, false, &probes);
+        binseq_map_print_stats(dict->records, "records");
+    }
+
+    dictionary_free(dict);
+    free(data);
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *dict_file = NULL;
+    int arg = 1;
+    if (arg + 1 < argc && strcmp(argv[arg], "-D") == 0) {
+        dict_file = argv[arg + 1];
+        arg += 2;
+    }
+    if (argc - arg != 1) {
+        printf("Usage: %s [-D <dictionary_file>] <input_file>\n", argv[0]);
+        return 1;
+    }
+    return benchFile(argv[arg], dict_file);
+}
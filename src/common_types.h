@@ -12,8 +12,27 @@ typedef struct {
     uint8_t group;       // There could be at most GROUP_MAX groups 
     uint8_t isUsed;      // 1 if the sequence was used, otherwise 0
     uint16_t codeword;   // Codeword corresponding to the sequence
+    uint8_t isRule;      // 1 if the sequence is the pair (left, right) of other symbols
+    uint16_t left;       // Pair symbols: a byte value, or 256 + index of another entry
+    uint16_t right;
 } BinarySequence;
 
+// What an encoder lookup of a dictionary sequence returns, in one place
+typedef struct {
+    int frequency;       // Training frequency, or uses once reparsed
+    int32_t savings;     // Saving of one use under the current cost model
+    uint16_t entry;      // Index of the entry in the dictionary
+    uint16_t codeword;
+    uint8_t group;
+} SequenceRecord;
+
+// Token lengths of the chosen parse, in input order. A length of 1 is a
+// literal byte; longer tokens are dictionary sequences.
+typedef struct {
+    uint8_t *compress_sequence;       // Length of each token
+    uint32_t compress_sequence_count; // Valid entries in compress_sequence
+    uint32_t capacity;                // Allocated entries in compress_sequence
+} CompressPath;
 
 
 #endif
@@ -14,6 +14,9 @@
 #define SEQ_LENGTH_LIMIT 64 //a.k.a k
 #define BLOCK_SIZE 10000
 
+// Bit of a sequence length in the 64-bit length masks
+#define SEQ_LENGTH_BIT(len) (1ULL << ((len) - SEQ_LENGTH_START))
+
 #define TOTAL_GROUPS 4
 
 #endif
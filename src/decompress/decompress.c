@@ -13,26 +13,32 @@ typedef struct {
     uint16_t codeword;
 } BinarySequence;
 
-static inline uint8_t groupCodeSize(uint8_t group) {
-    switch(group) {
-        case 0: return 4;
-        case 1: return 4;
-        case 2: return 4;
-        case 3: return 12;
-        default:
-            fprintf(stderr, "Invalid group %d\n", group);
-            return 0;
-    }
-}
+// Codeword widths of the groups, read from the stream or dictionary header
+typedef struct {
+    uint8_t group_count;
+    uint8_t code_bits[TOTAL_GROUPS];
+} GroupLayout;
 
 #define BUFFER_SIZE (1024 * 1024)
+#define HEADER_LENGTH_BITS 6          // Header stores length-1 of each entry
+#define GROUP_COUNT_BITS 2            // Header stores group count-1
+#define GROUP_WIDTH_BITS 4            // Header stores the codeword width of each group
+#define GROUP_MAX_CODE_BITS 13
+#define DICT_MAGIC "TKDC"
+#define DICT_FORMAT_VERSION 3
+#define DICT_SYMBOL_BASE 256          // Pair symbols >= this refer to another entry
+#define DICT_FORM_BYTES 0
+#define DICT_FORM_PAIR 1
+#define DICT_REFERENCE_MARKER 0xFFFF  // Header count meaning "stream uses a shared dictionary"
+#define DICT_STORED_MARKER 0xFFFE     // Header count meaning "the input follows as is"
 
 static uint8_t findEndOfHeaderMarker(FILE* input, uint8_t* byte_buffer, size_t* byte_pos, size_t* bytes_read);
 static uint16_t read_bits(uint8_t num_bits, uint8_t* bit_buffer, uint8_t* bit_pos,
                          uint8_t* byte_buffer, size_t* byte_pos, size_t* bytes_read, FILE* file);
                          
 static void print_binary(uint8_t byte);
-static BinarySequence* readHeader(FILE* file, uint16_t* sequence_count, uint8_t* byte_buffer, size_t* byte_pos, size_t* bytes_read);
+static BinarySequence* readHeader(FILE* file, uint16_t sequence_count, GroupLayout* layout,
+                                  uint8_t* byte_buffer, size_t* byte_pos, size_t* bytes_read);
                          
 static uint8_t* create_aligned_buffer() {
     uint8_t* buf = aligned_alloc(64, BUFFER_SIZE);
@@ -43,25 +49,156 @@ static uint8_t* create_aligned_buffer() {
     return buf;
 }
 
-static BinarySequence* readHeader(FILE* file, uint16_t* sequence_count, uint8_t* byte_buffer, size_t* byte_pos, size_t* bytes_read) {
-    #ifdef DEBUG
-    printf("\n=== READING HEADER ===\n");
-    #endif
-    
-    // Read sequence count (2 bytes big-endian)
-    uint8_t count_bytes[2];
-    if (fread(count_bytes, 1, 2, file) != 2) {
-        fprintf(stderr, "Error: Failed to read sequence count\n");
+// Bits a token spends on its group: none for a single group
+static uint8_t groupSelectorBits(const GroupLayout* layout) {
+    uint8_t bits = 0;
+    while ((1u << bits) < layout->group_count) bits++;
+    return bits;
+}
+
+static int validLayout(const GroupLayout* layout) {
+    if (layout->group_count == 0 || layout->group_count > TOTAL_GROUPS) return 0;
+    for (uint8_t g = 0; g < layout->group_count; g++) {
+        if (layout->code_bits[g] > GROUP_MAX_CODE_BITS) return 0;
+    }
+    return 1;
+}
+
+static void freeSequences(BinarySequence* sequences, uint16_t sequence_count) {
+    if (!sequences) return;
+    for (int i = 0; i < sequence_count; i++) {
+        free(sequences[i].sequence);
+    }
+    free(sequences);
+}
+
+/**
+ * @brief Expands a pair entry into its bytes, expanding the entries it refers to first
+ */
+static int flattenSequence(BinarySequence* sequences, uint16_t count, const uint16_t* pairs,
+                           uint16_t index, int depth) {
+    BinarySequence* entry = &sequences[index];
+    if (entry->sequence) return 1;
+    if (depth > 255) return 0;
+
+    entry->sequence = malloc(entry->length);
+    if (!entry->sequence) return 0;
+
+    int offset = 0;
+    for (int s = 0; s < 2; s++) {
+        uint16_t symbol = pairs[index * 2 + s];
+        if (symbol < DICT_SYMBOL_BASE) {
+            if (offset + 1 > entry->length) return 0;
+            entry->sequence[offset++] = (uint8_t)symbol;
+            continue;
+        }
+        uint16_t child = symbol - DICT_SYMBOL_BASE;
+        if (child >= count || !flattenSequence(sequences, count, pairs, child, depth + 1)) return 0;
+        if (offset + sequences[child].length > entry->length) return 0;
+        memcpy(entry->sequence + offset, sequences[child].sequence, sequences[child].length);
+        offset += sequences[child].length;
+    }
+    return offset == entry->length;
+}
+
+/**
+ * @brief Loads the entries of a shared dictionary file written by "compress --train".
+ * Entries stored as pairs are expanded here, so decoding only sees flat sequences.
+ */
+static BinarySequence* loadDictionary(const char* filename, uint16_t* sequence_count, uint32_t* dict_id,
+                                      GroupLayout* layout) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        perror("Error opening dictionary");
         return NULL;
     }
-    *sequence_count = (count_bytes[0] << 8) | count_bytes[1];
-    
+
+    // Magic, version, 4-byte id, 2-byte count
+    uint8_t header[11];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) ||
+        memcmp(header, DICT_MAGIC, 4) != 0 || header[4] != DICT_FORMAT_VERSION) {
+        fprintf(stderr, "Error: %s is not a dictionary file\n", filename);
+        fclose(file);
+        return NULL;
+    }
+    *dict_id = ((uint32_t)header[5] << 24) | ((uint32_t)header[6] << 16) |
+               ((uint32_t)header[7] << 8) | header[8];
+    uint16_t count = (header[9] << 8) | header[10];
+
+    // 1-byte group count, then the codeword width of each group
+    if (fread(&layout->group_count, 1, 1, file) != 1 || layout->group_count == 0 ||
+        layout->group_count > TOTAL_GROUPS ||
+        fread(layout->code_bits, 1, layout->group_count, file) != layout->group_count ||
+        !validLayout(layout)) {
+        fprintf(stderr, "Error: Dictionary %s has an invalid group layout\n", filename);
+        fclose(file);
+        return NULL;
+    }
+
+    BinarySequence* sequences = calloc(count ? count : 1, sizeof(BinarySequence));
+    uint16_t* pairs = calloc(count ? count * 2 : 2, sizeof(uint16_t));
+    if (!sequences || !pairs) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        free(sequences);
+        free(pairs);
+        fclose(file);
+        return NULL;
+    }
+
+    // Each entry: 1-byte length, 1-byte form, bytes or 2 pair symbols,
+    // 1-byte group, 2-byte codeword, 4-byte frequency
+    int ok = 1;
+    for (uint16_t i = 0; ok && i < count; i++) {
+        uint8_t prefix[2];
+        uint8_t meta[7];
+        ok = fread(prefix, 1, sizeof(prefix), file) == sizeof(prefix) && prefix[0] > 0;
+        if (ok && prefix[1] == DICT_FORM_PAIR) {
+            uint8_t pair[4];
+            ok = fread(pair, 1, sizeof(pair), file) == sizeof(pair);
+            pairs[i * 2] = (pair[0] << 8) | pair[1];
+            pairs[i * 2 + 1] = (pair[2] << 8) | pair[3];
+        } else if (ok && prefix[1] == DICT_FORM_BYTES) {
+            ok = (sequences[i].sequence = malloc(prefix[0])) != NULL &&
+                 fread(sequences[i].sequence, 1, prefix[0], file) == prefix[0];
+        } else {
+            ok = 0;
+        }
+        ok = ok && fread(meta, 1, sizeof(meta), file) == sizeof(meta);
+        sequences[i].length = prefix[0];
+        sequences[i].group = meta[0];
+        sequences[i].codeword = (meta[1] << 8) | meta[2];
+    }
+    fclose(file);
+
+    for (uint16_t i = 0; ok && i < count; i++) {
+        ok = flattenSequence(sequences, count, pairs, i, 0);
+    }
+    free(pairs);
+    if (!ok) {
+        fprintf(stderr, "Error: Dictionary %s is truncated or corrupted\n", filename);
+        freeSequences(sequences, count);
+        return NULL;
+    }
+
+    #ifdef DEBUG
+    printf("Loaded dictionary %s: %d sequences, id %08X\n", filename, count, *dict_id);
+    #endif
+    *sequence_count = count;
+    return sequences;
+}
+
+/**
+ * @brief Reads the group layout and the used sequences of a stream header.
+ * Sequences come in codeword order, so each one gets the next codeword of its group.
+ */
+static BinarySequence* readHeader(FILE* file, uint16_t sequence_count, GroupLayout* layout,
+                                  uint8_t* byte_buffer, size_t* byte_pos, size_t* bytes_read) {
     #ifdef DEBUG
-    printf("Header indicates %d sequences\n", *sequence_count);
-    printf("Count bytes: %02X %02X\n", count_bytes[0], count_bytes[1]);
+    printf("\n=== READING HEADER ===\n");
+    printf("Header indicates %d sequences\n", sequence_count);
     #endif
     
-    BinarySequence* sequences = calloc(*sequence_count, sizeof(BinarySequence));
+    BinarySequence* sequences = calloc(sequence_count ? sequence_count : 1, sizeof(BinarySequence));
     if (!sequences) {
         fprintf(stderr, "Error: Memory allocation failed\n");
         return NULL;
@@ -82,19 +219,47 @@ static BinarySequence* readHeader(FILE* file, uint16_t* sequence_count, uint8_t*
     }
     #endif
 
-    int i;
-    for (i = 0; i < *sequence_count; i++) {
+    int i = 0;
+    uint16_t count_bits = read_bits(GROUP_COUNT_BITS, &bit_buffer, &bit_pos, byte_buffer, byte_pos, bytes_read, file);
+    if (count_bits == 0xFFFF) {
+        fprintf(stderr, "Error: Failed to read group layout\n");
+        goto error_cleanup;
+    }
+    layout->group_count = (uint8_t)count_bits + 1;
+    for (uint8_t g = 0; g < layout->group_count; g++) {
+        uint16_t width = read_bits(GROUP_WIDTH_BITS, &bit_buffer, &bit_pos, byte_buffer, byte_pos, bytes_read, file);
+        if (width == 0xFFFF) {
+            fprintf(stderr, "Error: Failed to read group layout\n");
+            goto error_cleanup;
+        }
+        layout->code_bits[g] = (uint8_t)width;
+    }
+    if (!validLayout(layout)) {
+        fprintf(stderr, "Error: Invalid group layout\n");
+        goto error_cleanup;
+    }
+
+    #ifdef DEBUG
+    printf("Layout: %d groups, widths", layout->group_count);
+    for (uint8_t g = 0; g < layout->group_count; g++) printf(" %d", layout->code_bits[g]);
+    printf("\n");
+    #endif
+
+    uint8_t group = 0;
+    uint16_t codeword = 0;
+    for (i = 0; i < sequence_count; i++) {
         #ifdef DEBUG
-        printf("\nProcessing sequence %d/%d\n", i+1, *sequence_count);
+        printf("\nProcessing sequence %d/%d\n", i+1, sequence_count);
         printf("Current position: byte %zu, bit %d\n", *byte_pos, bit_pos);
         #endif
         
-        // 1. Read 3-bit length (MSB first)
-        uint8_t length = read_bits(3, &bit_buffer, &bit_pos, byte_buffer, byte_pos, bytes_read, file);
-        if (length == 0xFF) {
+        // 1. Read 6-bit length-1 (MSB first)
+        uint16_t length_bits = read_bits(HEADER_LENGTH_BITS, &bit_buffer, &bit_pos, byte_buffer, byte_pos, bytes_read, file);
+        if (length_bits == 0xFFFF) {
             fprintf(stderr, "Error: Failed to read length\n");
             goto error_cleanup;
         }
+        uint8_t length = (uint8_t)length_bits + 1;
         sequences[i].length = length;
         
         #ifdef DEBUG
@@ -123,25 +288,20 @@ static BinarySequence* readHeader(FILE* file, uint16_t* sequence_count, uint8_t*
         printf("\n");
         #endif
 
-        // 3. Read 2-bit group (MSB first)
-        uint8_t group = read_bits(2, &bit_buffer, &bit_pos, byte_buffer, byte_pos, bytes_read, file);
-        if (group == 0xFF) {
-            fprintf(stderr, "Error: Failed to read group\n");
-            goto error_cleanup;
+        // 3. Next codeword in order, moving on when the group is full
+        while (group < layout->group_count && (codeword >> layout->code_bits[group])) {
+            group++;
+            codeword = 0;
         }
-        sequences[i].group = group;
-        
-        // 4. Read codeword (MSB first)
-        uint8_t code_size = groupCodeSize(group);
-        uint16_t codeword = read_bits(code_size, &bit_buffer, &bit_pos, byte_buffer, byte_pos, bytes_read, file);
-        if (codeword == 0xFFFF) {
-            fprintf(stderr, "Error: Failed to read codeword\n");
+        if (group == layout->group_count) {
+            fprintf(stderr, "Error: More sequences than the group layout holds\n");
             goto error_cleanup;
         }
-        sequences[i].codeword = codeword;
+        sequences[i].group = group;
+        sequences[i].codeword = codeword++;
         
         #ifdef DEBUG
-        printf("Read group: %d, codeword: %d (%d bits)\n", group, codeword, code_size);
+        printf("Assigned group: %d, codeword: %d\n", sequences[i].group, sequences[i].codeword);
         #endif
     }
     
@@ -154,10 +314,7 @@ static BinarySequence* readHeader(FILE* file, uint16_t* sequence_count, uint8_t*
     return sequences;
 
 error_cleanup:
-    for (int j = 0; j < i; j++) {
-        if (sequences[j].sequence) free(sequences[j].sequence);
-    }
-    free(sequences);
+    freeSequences(sequences, i + 1);
     return NULL;
 }
 
@@ -223,16 +380,39 @@ static uint8_t findEndOfHeaderMarker(FILE* input, uint8_t* byte_buffer, size_t*
     }
 }
 
-static void decompressData(FILE* input, FILE* output, 
-                         BinarySequence* sequences, uint16_t sequence_count,
+// Decodes the data section; returns 1 when it ends cleanly, 0 on a decode error
+static int decompressData(FILE* input, FILE* output, 
+                         BinarySequence* sequences, uint16_t sequence_count, const GroupLayout* layout,
                          uint8_t* byte_buffer, size_t* byte_pos, size_t* bytes_read) {
     #ifdef DEBUG
     printf("\n\n=== READING Data ===\n");
     #endif
+
+    // Sequence of each (group, codeword), at first_code[group] + codeword
+    uint32_t first_code[TOTAL_GROUPS];
+    uint32_t code_count = 0;
+    for (uint8_t g = 0; g < layout->group_count; g++) {
+        first_code[g] = code_count;
+        code_count += 1u << layout->code_bits[g];
+    }
+    BinarySequence** by_code = calloc(code_count, sizeof(BinarySequence*));
+    if (!by_code) {
+        fprintf(stderr, "Error: Memory allocation failed\n");
+        return 0;
+    }
+    for (int i = 0; i < sequence_count; i++) {
+        if (sequences[i].group < layout->group_count &&
+            !(sequences[i].codeword >> layout->code_bits[sequences[i].group])) {
+            by_code[first_code[sequences[i].group] + sequences[i].codeword] = &sequences[i];
+        }
+    }
+    uint8_t selector_bits = groupSelectorBits(layout);
+
     uint8_t* out_buffer = create_aligned_buffer();
     size_t out_pos = 0;
     uint8_t bit_buffer = 0;
     uint8_t bit_pos = 0;
+    int ok = 0;
 
     while (1) {
         // Read 1-bit flag
@@ -247,6 +427,8 @@ static void decompressData(FILE* input, FILE* output,
             // Uncompressed data - read 8 bits (1 byte)
             uint16_t byte = read_bits(8, &bit_buffer, &bit_pos, byte_buffer, byte_pos, bytes_read, input);
             if (byte == 0xFFFF) {
+                // Zero bits padding the last byte look like a truncated literal
+                if (*bytes_read == 0) break;
                 fprintf(stderr, "Unexpected EOF reading uncompressed byte\n");
                 goto done;
             }
@@ -262,13 +444,17 @@ static void decompressData(FILE* input, FILE* output,
             }
         } else {
             // Compressed data - read group and codeword
-            uint16_t group = read_bits(2, &bit_buffer, &bit_pos, byte_buffer, byte_pos, bytes_read, input);
+            uint16_t group = read_bits(selector_bits, &bit_buffer, &bit_pos, byte_buffer, byte_pos, bytes_read, input);
             if (group == 0xFFFF) {
                 fprintf(stderr, "Unexpected EOF reading group\n");
                 goto done;
             }
+            if (group >= layout->group_count) {
+                fprintf(stderr, "Error: Invalid group %d\n", group);
+                goto done;
+            }
 
-            uint8_t code_size = groupCodeSize((uint8_t)group);
+            uint8_t code_size = layout->code_bits[group];
 			
             uint16_t codeword = read_bits(code_size, &bit_buffer, &bit_pos, byte_buffer, byte_pos, bytes_read, input);
             if (codeword == 0xFFFF) {
@@ -281,33 +467,26 @@ static void decompressData(FILE* input, FILE* output,
                   group, codeword, code_size);
             #endif
 
-            // Find matching sequence
-            int found = 0;
-            for (int i = 0; i < sequence_count; i++) {
-                if (sequences[i].group == group && sequences[i].codeword == codeword) {
-                    #ifdef DEBUG
-                    printf("Found matching sequence: ");
-                    for (int j = 0; j < sequences[i].length; j++) {
-                        printf("%02X ", sequences[i].sequence[j]);
-                    }
-                    printf("\n");
-                    #endif
-
-                    if (out_pos + sequences[i].length > BUFFER_SIZE) {
-                        fwrite(out_buffer, 1, out_pos, output);
-                        out_pos = 0;
-                    }
-                    memcpy(out_buffer + out_pos, sequences[i].sequence, sequences[i].length);
-                    out_pos += sequences[i].length;
-                    found = 1;
-                    break;
-                }
-            }
-
-            if (!found) {
+            BinarySequence* match = by_code[first_code[group] + codeword];
+            if (!match) {
                 fprintf(stderr, "Error: No match for group=%d codeword=0x%04X\n", group, codeword);
                 goto done;
             }
+
+            #ifdef DEBUG
+            printf("Found matching sequence: ");
+            for (int j = 0; j < match->length; j++) {
+                printf("%02X ", match->sequence[j]);
+            }
+            printf("\n");
+            #endif
+
+            if (out_pos + match->length > BUFFER_SIZE) {
+                fwrite(out_buffer, 1, out_pos, output);
+                out_pos = 0;
+            }
+            memcpy(out_buffer + out_pos, match->sequence, match->length);
+            out_pos += match->length;
         }
 
         #ifdef DEBUG
@@ -318,35 +497,95 @@ static void decompressData(FILE* input, FILE* output,
         printf("\n");
         #endif
     }
+    ok = 1;
 
 done:
     if (out_pos > 0) {
         fwrite(out_buffer, 1, out_pos, output);
     }
     free(out_buffer);
+    free(by_code);
+    return ok;
 }
 
-void decompressBinaryFile(const char* input_filename, const char* output_filename) {
+// Copies the rest of a stored file to output; returns 1 on success, 0 on a read or write error
+static int copyStored(FILE* input, FILE* output, uint8_t* buffer) {
+    size_t n;
+    while ((n = fread(buffer, 1, BUFFER_SIZE, input)) > 0) {
+        if (fwrite(buffer, 1, n, output) != n) {
+            perror("Error writing output");
+            return 0;
+        }
+    }
+    if (ferror(input)) {
+        fprintf(stderr, "Error: Failed to read stored data\n");
+        return 0;
+    }
+    return 1;
+}
+
+/**
+ * Decompresses input_filename into output_filename.
+ * @return 1 on success, 0 if the stream could not be decoded or written
+ */
+int decompressBinaryFile(const char* input_filename, const char* output_filename, const char* dict_filename) {
     FILE* input = fopen(input_filename, "rb");
     FILE* output = fopen(output_filename, "wb");
     if (!input || !output) {
         perror("Error opening files");
         if (input) fclose(input);
         if (output) fclose(output);
-        return;
+        return 0;
     }
 
     uint8_t* byte_buffer = create_aligned_buffer();
     size_t byte_pos = 0;
     size_t bytes_read = 0;
 
-    uint16_t sequence_count;
-    BinarySequence* sequences = readHeader(input, &sequence_count, byte_buffer, &byte_pos, &bytes_read);
+    // Read sequence count (2 bytes big-endian)
+    uint8_t count_bytes[2];
+    uint16_t sequence_count = 0;
+    BinarySequence* sequences = NULL;
+    GroupLayout layout = {0};
+    if (fread(count_bytes, 1, 2, input) != 2) {
+        fprintf(stderr, "Error: Failed to read sequence count\n");
+    } else if (((count_bytes[0] << 8) | count_bytes[1]) == DICT_STORED_MARKER) {
+        // The input follows as is
+        int ok = copyStored(input, output, byte_buffer);
+        free(byte_buffer);
+        fclose(input);
+        if (fclose(output) != 0 && ok) {
+            perror("Error writing output");
+            ok = 0;
+        }
+        return ok;
+    } else if (((count_bytes[0] << 8) | count_bytes[1]) == DICT_REFERENCE_MARKER) {
+        // Stream references a shared dictionary by id
+        uint8_t id_bytes[4];
+        uint32_t dict_id = 0;
+        if (fread(id_bytes, 1, 4, input) != 4) {
+            fprintf(stderr, "Error: Failed to read dictionary id\n");
+        } else if (!dict_filename) {
+            fprintf(stderr, "Error: Stream needs a dictionary, pass it with -D\n");
+        } else if ((sequences = loadDictionary(dict_filename, &sequence_count, &dict_id, &layout)) != NULL) {
+            uint32_t stream_id = ((uint32_t)id_bytes[0] << 24) | ((uint32_t)id_bytes[1] << 16) |
+                                 ((uint32_t)id_bytes[2] << 8) | id_bytes[3];
+            if (stream_id != dict_id) {
+                fprintf(stderr, "Error: Stream needs dictionary %08X but %s is %08X\n",
+                        stream_id, dict_filename, dict_id);
+                freeSequences(sequences, sequence_count);
+                sequences = NULL;
+            }
+        }
+    } else {
+        sequence_count = (count_bytes[0] << 8) | count_bytes[1];
+        sequences = readHeader(input, sequence_count, &layout, byte_buffer, &byte_pos, &bytes_read);
+    }
     if (!sequences) {
         fclose(input);
         fclose(output);
         free(byte_buffer);
-        return;
+        return 0;
     }
     
     #ifdef DEBUG
@@ -355,33 +594,44 @@ void decompressBinaryFile(const char* input_filename, const char* output_filenam
     #endif
 
     // Find the end-of-header marker (0xFF)
+    int ok = 0;
     if (findEndOfHeaderMarker(input, byte_buffer, &byte_pos, &bytes_read)) {
         #ifdef DEBUG
         printf("Starting data decompression at byte %zu\n", byte_pos);
         #endif
         
-        decompressData(input, output, sequences, sequence_count, byte_buffer, &byte_pos, &bytes_read);
+        ok = decompressData(input, output, sequences, sequence_count, &layout, byte_buffer, &byte_pos, &bytes_read);
     } else {
         fprintf(stderr, "Error: Could not find end-of-header marker\n");
     }
 
-    for (int i = 0; i < sequence_count; i++) {
-        free(sequences[i].sequence);
-    }
-    free(sequences);
+    freeSequences(sequences, sequence_count);
     free(byte_buffer);
     fclose(input);
-    fclose(output);
+    if (fclose(output) != 0 && ok) {
+        perror("Error writing output");
+        ok = 0;
+    }
+    return ok;
 }
 
 int main(int argc, char** argv) {
-    if (argc != 3) {
-        fprintf(stderr, "Usage: %s <input> <output>\n", argv[0]);
+    const char* dict_filename = NULL;
+    int arg = 1;
+    if (argc > 2 && strcmp(argv[1], "-D") == 0) {
+        dict_filename = argv[2];
+        arg = 3;
+    }
+    if (argc - arg != 2) {
+        fprintf(stderr, "Usage: %s [-D <dictionary>] <input> <output>\n", argv[0]);
         return 1;
     }
 
-    printf("Decompressing %s to %s...\n", argv[1], argv[2]);
-    decompressBinaryFile(argv[1], argv[2]);
+    printf("Decompressing %s to %s...\n", argv[arg], argv[arg + 1]);
+    if (!decompressBinaryFile(argv[arg], argv[arg + 1], dict_filename)) {
+        fprintf(stderr, "Decompression of %s failed\n", argv[arg]);
+        return 1;
+    }
     printf("Done.\n");
 
     return 0;
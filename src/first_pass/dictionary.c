@@ -0,0 +1,743 @@
+// first_pass/dictionary.c
+
+#include "dictionary.h"
+#include "repair.h"
+#include "suffix_array.h"
+#include "../constants.h"
+#include "../second_pass/group.h"
+#include "../second_pass/seq_compare.h"
+#include "../second_pass/select.h"
+#include "xxhash.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define COUNT_BATCH 16  // Sequences whose prefix and suffix countCandidates looks up at once
+
+typedef struct {
+    BinSeqMapItem item;
+    int64_t savings;
+} Candidate;
+
+typedef struct {
+    uint32_t rule;
+    uint32_t length;
+    int64_t savings;
+} RuleCandidate;
+
+/**
+ * Estimated bits saved by an entry, assuming it lands in the widest group of the
+ * default layout. A literal costs 9 bits (flag + byte); a token costs flag + group + codeword.
+ */
+static int64_t entrySavings(uint16_t length, int frequency, bool shared) {
+    GroupLayout layout;
+    groupLayoutDefault(&layout);
+    uint8_t group = layout.group_count - 1;
+    int64_t per_use = (int64_t)length * 9 - (groupOverHead(&layout) + groupCodeSize(&layout, group));
+    int64_t savings = per_use * frequency;
+    if (!shared) {
+        savings -= getHeaderOverhead(length);
+    }
+    return savings;
+}
+
+// Best savings first; ties are broken by content so every counting backend ranks alike
+static int compareCandidates(const void* a, const void* b) {
+    const Candidate* ca = a;
+    const Candidate* cb = b;
+    if (ca->savings != cb->savings) return ca->savings > cb->savings ? -1 : 1;
+    if (ca->item.key_length != cb->item.key_length) {
+        return (int)cb->item.key_length - (int)ca->item.key_length;
+    }
+    uint16_t common = seq_common_prefix(ca->item.key_sequence, cb->item.key_sequence, ca->item.key_length);
+    if (common == ca->item.key_length) return 0;
+    return (int)ca->item.key_sequence[common] - (int)cb->item.key_sequence[common];
+}
+
+static int compareRuleCandidates(const void* a, const void* b) {
+    const RuleCandidate* ca = a;
+    const RuleCandidate* cb = b;
+    if (ca->savings != cb->savings) return ca->savings > cb->savings ? -1 : 1;
+    return (int)cb->length - (int)ca->length;
+}
+
+/**
+ * Counts the sequences of length SEQ_LENGTH_START (2) in a table indexed by the
+ * two bytes themselves, then puts every pair seen into the map. The map only sees
+ * pairs again as the prefixes and suffixes of length 3, about 1% of the counting
+ * time on tests/testText.txt, so the direct table stays here rather than in the map.
+ * @return 1 on success, 0 on allocation failure
+ */
+static int countPairs(BinSeqMap* map, const uint8_t* const* samples, const size_t* sample_sizes,
+                      int sample_count) {
+    int* counts = calloc(1 << 16, sizeof(int));
+    if (!counts) return 0;
+    for (int s = 0; s < sample_count; s++) {
+        const uint8_t* sample = samples[s];
+        for (size_t pos = 0; pos + 2 <= sample_sizes[s]; pos++) {
+            counts[sample[pos] << 8 | sample[pos + 1]]++;
+        }
+    }
+
+    int ok = 1;
+    for (uint32_t pair = 0; ok && pair < (1 << 16); pair++) {
+        if (counts[pair] == 0) continue;
+        uint8_t seq[2] = {(uint8_t)(pair >> 8), (uint8_t)pair};
+        ok = binseq_map_put(map, seq, 2, counts[pair]);
+    }
+    free(counts);
+    return ok;
+}
+
+// Times the capped map was full so far
+static size_t evictionRounds(const BinSeqMap* map) {
+    BinSeqMapEvictionStats evictions;
+    return binseq_map_eviction_stats(map, &evictions) ? evictions.rounds : 0;
+}
+
+/**
+ * Counts sequences length by length. A sequence of length n is only counted when
+ * both of its (n-1)-long prefix and suffix were repeated, so the map holds little
+ * more than the repeated sequences.
+ */
+static BinSeqMap* countCandidates(const uint8_t* const* samples, const size_t* sample_sizes,
+                                  int sample_count, bool stats) {
+    BinSeqMap* map = binseq_map_create(1 << 16);
+    if (!map || (stats && !binseq_map_enable_stats(map))) {
+        binseq_map_free(map);
+        return NULL;
+    }
+    // Large samples grow the map through many resizes; spread each over the inserts
+    binseq_map_set_incremental_resize(map, true);
+    binseq_map_set_limit(map, DICT_MAX_CANDIDATES);
+
+    if (!countPairs(map, samples, sample_sizes, sample_count)) {
+        binseq_map_free(map);
+        return NULL;
+    }
+    for (uint16_t len = SEQ_LENGTH_START + 1; len <= SEQ_LENGTH_LIMIT; len++) {
+        size_t repeated = 0;
+        for (int s = 0; s < sample_count; s++) {
+            const uint8_t* sample = samples[s];
+            if (sample_sizes[s] < len) continue;
+
+            size_t positions = sample_sizes[s] - len + 1;
+            for (size_t pos = 0; pos < positions;) {
+                // The suffix of the sequence at pos is the prefix of the one at pos + 1,
+                // so one batch of n + 1 parts covers n sequences
+                size_t n = MIN((size_t)COUNT_BATCH, positions - pos);
+                const uint8_t* parts[COUNT_BATCH + 1];
+                uint16_t part_lens[COUNT_BATCH + 1];
+                const SequenceRecord* records[COUNT_BATCH + 1];
+                bool repeated_part[COUNT_BATCH + 1];
+                for (size_t i = 0; i <= n; i++) {
+                    parts[i] = &sample[pos + i];
+                    part_lens[i] = len - 1;
+                }
+                binseq_map_get_batch(map, parts, part_lens, records, n + 1);
+                // Records move when the map grows, so only their verdicts are kept
+                for (size_t i = 0; i <= n; i++) {
+                    repeated_part[i] = records[i] && records[i]->frequency >= DICT_MIN_FREQUENCY;
+                }
+
+                size_t rounds = evictionRounds(map);
+                size_t i = 0;
+                while (i < n) {
+                    const uint8_t* seq = parts[i];
+                    bool counted = repeated_part[i] && repeated_part[i + 1];
+                    i++;
+                    if (!counted) continue;
+
+                    const int* freq = binseq_map_get_frequency(map, seq, len);
+                    if (freq) {
+                        binseq_map_increment_frequency(map, seq, len);
+                        if (*freq == DICT_MIN_FREQUENCY) repeated++;
+                    } else if (!binseq_map_put(map, seq, len, 1)) {
+                        binseq_map_free(map);
+                        return NULL;
+                    }
+                    // An eviction may have dropped parts looked up already
+                    if (evictionRounds(map) != rounds) break;
+                }
+                pos += i;
+            }
+        }
+        // No repeated sequence of this length means none of any longer length
+        if (repeated == 0) break;
+    }
+
+    BinSeqMapEvictionStats evictions;
+    if (binseq_map_eviction_stats(map, &evictions) && evictions.evicted > 0) {
+        fprintf(stderr, "Warning: Candidate map was full %zu times, %zu sequences evicted\n",
+                evictions.rounds, evictions.evicted);
+    }
+    binseq_map_print_stats(map, "candidate counts");
+    return map;
+}
+
+// Records which entry lengths occur, overall and per first byte
+static void buildLengthMasks(Dictionary* dict) {
+    for (uint16_t i = 0; i < dict->count; i++) {
+        const BinarySequence* entry = &dict->entries[i];
+        if (entry->length < SEQ_LENGTH_START || entry->length > SEQ_LENGTH_LIMIT) continue;
+        dict->lengths_present |= SEQ_LENGTH_BIT(entry->length);
+        dict->lengths_by_first_byte[entry->sequence[0]] |= SEQ_LENGTH_BIT(entry->length);
+    }
+}
+
+/**
+ * Copies the record of every frozen slot into the map, which thus holds the same
+ * record as the frozen table for every sequence.
+ * @return 1 on success, 0 on allocation failure
+ */
+static int updateRecords(Dictionary* dict) {
+    for (uint16_t i = 0; i < dict->count; i++) {
+        const BinarySequence* entry = &dict->entries[i];
+        if (entry->length <= 0 || entry->length > SEQ_LENGTH_LIMIT) continue;
+        const PerfectHashSlot* slot = perfect_hash_find(dict->frozen, entry->sequence, (uint16_t)entry->length);
+        if (!slot || slot->record.entry != i) continue;  // A later entry has the same bytes
+        if (!binseq_map_put_record(dict->records, entry->sequence, (uint16_t)entry->length, &slot->record)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// Builds the lookup structures of the entries; the records map is built on request
+static int buildIndex(Dictionary* dict) {
+    buildLengthMasks(dict);
+    dict->frozen = perfect_hash_build(dict->entries, dict->count);
+    return dict->frozen != NULL;
+}
+
+static Dictionary* allocDictionary(uint16_t count) {
+    Dictionary* dict = calloc(1, sizeof(Dictionary));
+    if (!dict) return NULL;
+    dict->entries = calloc(count ? count : 1, sizeof(BinarySequence));
+    if (!dict->entries) {
+        free(dict);
+        return NULL;
+    }
+    groupLayoutDefault(&dict->layout);
+    return dict;
+}
+
+/**
+ * Makes a new dictionary of ranked items, best first; their keys are copied.
+ * @param count At most DICT_MAX_ENTRIES
+ */
+static Dictionary* dictionaryOfItems(const BinSeqMapItem* items, uint16_t count) {
+    Dictionary* dict = allocDictionary(count);
+    if (!dict) return NULL;
+
+    for (uint16_t i = 0; i < count; i++) {
+        const BinSeqMapItem* item = &items[i];
+        BinarySequence* entry = &dict->entries[i];
+        entry->sequence = malloc(item->key_length);
+        if (!entry->sequence) {
+            dictionary_free(dict);
+            return NULL;
+        }
+        memcpy(entry->sequence, item->key_sequence, item->key_length);
+        entry->length = item->key_length;
+        entry->frequency = item->frequency;
+        dict->count++;
+    }
+
+    if (!buildIndex(dict)) {
+        dictionary_free(dict);
+        return NULL;
+    }
+    dictionary_update_id(dict);
+    return dict;
+}
+
+/**
+ * Keeps the DICT_MAX_ENTRIES best candidates as the entries of a new dictionary.
+ * Candidates are reordered in place, only the kept ones sorted; their keys are copied.
+ */
+static Dictionary* selectCandidates(Candidate* candidates, size_t candidate_count) {
+    uint16_t count = (uint16_t)MIN(candidate_count, (size_t)DICT_MAX_ENTRIES);
+    select_best(candidates, candidate_count, sizeof(Candidate), count, compareCandidates);
+    if (count > 0) {
+        qsort(candidates, count, sizeof(Candidate), compareCandidates);
+    }
+    BinSeqMapItem items[DICT_MAX_ENTRIES];
+    for (uint16_t i = 0; i < count; i++) {
+        items[i] = candidates[i].item;
+    }
+    return dictionaryOfItems(items, count);
+}
+
+// binseq_map_top_k score of a counted sequence: its savings, if it is a candidate
+static int64_t scoreCandidate(const BinSeqMapItem* item, void* context) {
+    bool shared = *(const bool*)context;
+    if (item->frequency < DICT_MIN_FREQUENCY) return BINSEQ_MAP_SKIP;
+    int64_t savings = entrySavings(item->key_length, item->frequency, shared);
+    return savings > 0 ? savings : BINSEQ_MAP_SKIP;
+}
+
+Dictionary* dictionary_train(const uint8_t* const* samples, const size_t* sample_sizes,
+                             int sample_count, bool shared, bool stats) {
+    if (!samples || !sample_sizes || sample_count <= 0) {
+        fprintf(stderr, "Error: Invalid parameters in dictionary_train\n");
+        return NULL;
+    }
+
+    BinSeqMap* counts = countCandidates(samples, sample_sizes, sample_count, stats);
+    if (!counts) {
+        fprintf(stderr, "Error: Unable to count candidate sequences\n");
+        return NULL;
+    }
+
+    // Same ranking as compareCandidates, without sorting every counted sequence
+    BinSeqMapItem* best = malloc(DICT_MAX_ENTRIES * sizeof(BinSeqMapItem));
+    if (!best) {
+        binseq_map_free(counts);
+        return NULL;
+    }
+    size_t count = binseq_map_top_k(counts, DICT_MAX_ENTRIES, scoreCandidate, &shared, best);
+
+    Dictionary* dict = dictionaryOfItems(best, (uint16_t)count);
+    free(best);
+    binseq_map_free(counts);
+    return dict;
+}
+
+#define SA_SENTINEL 0       // Ends the text, smaller than every other symbol
+#define SA_SEPARATOR 1      // Between samples, never part of a repeat
+#define SA_FIRST_BYTE 2     // Byte b is symbol SA_FIRST_BYTE + b
+
+static int appendCandidate(Candidate** candidates, size_t* count, size_t* capacity,
+                           const uint8_t* sequence, uint16_t length, int frequency, bool shared) {
+    int64_t savings = entrySavings(length, frequency, shared);
+    if (savings <= 0) return 1;
+    if (*count == *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 1024;
+        Candidate* grown = realloc(*candidates, new_capacity * sizeof(Candidate));
+        if (!grown) return 0;
+        *candidates = grown;
+        *capacity = new_capacity;
+    }
+    Candidate* candidate = &(*candidates)[(*count)++];
+    candidate->item.key_sequence = sequence;
+    candidate->item.key_length = length;
+    candidate->item.frequency = frequency;
+    candidate->savings = savings;
+    return 1;
+}
+
+/*
+ * Every repeated substring is the prefix of an lcp-interval [lb, rb] of the suffix
+ * array: its rb - lb + 1 suffixes share lcp symbols, and the lengths between the
+ * parent interval's lcp + 1 and lcp occur exactly that many times. One pass with a
+ * stack of open intervals visits each of them once.
+ */
+Dictionary* dictionary_train_suffix_array(const uint8_t* const* samples, const size_t* sample_sizes,
+                                          int sample_count, bool shared) {
+    if (!samples || !sample_sizes || sample_count <= 0) {
+        fprintf(stderr, "Error: Invalid parameters in dictionary_train_suffix_array\n");
+        return NULL;
+    }
+
+    size_t total = 1;
+    for (int s = 0; s < sample_count; s++) {
+        total += sample_sizes[s] + 1;
+    }
+    if (total >= INT32_MAX) {
+        fprintf(stderr, "Error: Training samples are too large for a suffix array\n");
+        return NULL;
+    }
+    int32_t n = (int32_t)total;
+
+    // Keys of the candidates point into bytes, laid out like text
+    uint8_t* bytes = malloc(n);
+    int32_t* text = malloc((size_t)n * sizeof(int32_t));
+    int32_t* sa = malloc((size_t)n * sizeof(int32_t));
+    int32_t* lcp = malloc((size_t)n * sizeof(int32_t));
+    int32_t* stack_lcp = malloc((size_t)n * sizeof(int32_t));
+    int32_t* stack_lb = malloc((size_t)n * sizeof(int32_t));
+    Candidate* candidates = NULL;
+    size_t candidate_count = 0;
+    size_t candidate_capacity = 0;
+    Dictionary* dict = NULL;
+    if (!bytes || !text || !sa || !lcp || !stack_lcp || !stack_lb) goto cleanup;
+
+    int32_t pos = 0;
+    for (int s = 0; s < sample_count; s++) {
+        for (size_t i = 0; i < sample_sizes[s]; i++) {
+            bytes[pos] = samples[s][i];
+            text[pos++] = SA_FIRST_BYTE + samples[s][i];
+        }
+        bytes[pos] = 0;
+        text[pos++] = SA_SEPARATOR;
+    }
+    bytes[pos] = 0;
+    text[pos] = SA_SENTINEL;
+
+    if (!suffix_array_build(text, sa, n, SA_FIRST_BYTE + UINT8_MAX) ||
+        !suffix_array_lcp(text, sa, lcp, n, SA_SEPARATOR)) {
+        goto cleanup;
+    }
+
+    int32_t top = 0;
+    stack_lcp[0] = 0;
+    stack_lb[0] = 0;
+    for (int32_t i = 1; i <= n; i++) {
+        int32_t current = (i < n) ? lcp[i] : 0;
+        int32_t lb = i - 1;
+        while (current < stack_lcp[top]) {
+            int32_t interval_lcp = stack_lcp[top];
+            lb = stack_lb[top];
+            top--;
+            int32_t parent_lcp = MAX(current, stack_lcp[top]);
+            int frequency = i - lb;
+            int32_t first = MAX(parent_lcp + 1, SEQ_LENGTH_START);
+            int32_t last = MIN(interval_lcp, SEQ_LENGTH_LIMIT);
+            for (int32_t length = first; frequency >= DICT_MIN_FREQUENCY && length <= last; length++) {
+                if (!appendCandidate(&candidates, &candidate_count, &candidate_capacity,
+                                     &bytes[sa[lb]], (uint16_t)length, frequency, shared)) {
+                    goto cleanup;
+                }
+            }
+        }
+        if (current > stack_lcp[top]) {
+            top++;
+            stack_lcp[top] = current;
+            stack_lb[top] = lb;
+        }
+    }
+
+    dict = selectCandidates(candidates, candidate_count);
+
+cleanup:
+    if (!dict) fprintf(stderr, "Error: Unable to enumerate repeated sequences\n");
+    free(bytes);
+    free(text);
+    free(sa);
+    free(lcp);
+    free(stack_lcp);
+    free(stack_lb);
+    free(candidates);
+    return dict;
+}
+
+// Maps a grammar symbol to a dictionary pair symbol; returns 0 if it is not representable
+static int dictionarySymbol(uint32_t symbol, const int32_t* entry_of_rule, uint16_t* out) {
+    if (symbol < REPAIR_FIRST_RULE) {
+        *out = (uint16_t)symbol;
+        return 1;
+    }
+    int32_t entry = entry_of_rule[symbol - REPAIR_FIRST_RULE];
+    if (entry < 0) return 0;
+    *out = (uint16_t)(DICT_SYMBOL_BASE + entry);
+    return 1;
+}
+
+Dictionary* dictionary_train_repair(const uint8_t* const* samples, const size_t* sample_sizes,
+                                    int sample_count, bool shared, bool stats) {
+    RepairGrammar grammar;
+    if (!repair_build(samples, sample_sizes, sample_count, DICT_MIN_FREQUENCY, stats, &grammar)) {
+        fprintf(stderr, "Error: Unable to build Re-Pair grammar\n");
+        return NULL;
+    }
+
+    RuleCandidate* candidates = malloc((grammar.count ? grammar.count : 1) * sizeof(RuleCandidate));
+    int32_t* entry_of_rule = malloc((grammar.count ? grammar.count : 1) * sizeof(int32_t));
+    if (!candidates || !entry_of_rule) {
+        free(candidates);
+        free(entry_of_rule);
+        repair_free(&grammar);
+        return NULL;
+    }
+
+    size_t candidate_count = 0;
+    for (uint32_t r = 0; r < grammar.count; r++) {
+        const RepairRule* rule = &grammar.rules[r];
+        entry_of_rule[r] = -1;
+        if (rule->length < SEQ_LENGTH_START || rule->length > SEQ_LENGTH_LIMIT) continue;
+        int64_t savings = entrySavings((uint16_t)rule->length, (int)rule->count, shared);
+        if (savings <= 0) continue;
+        candidates[candidate_count].rule = r;
+        candidates[candidate_count].length = rule->length;
+        candidates[candidate_count].savings = savings;
+        candidate_count++;
+    }
+    qsort(candidates, candidate_count, sizeof(RuleCandidate), compareRuleCandidates);
+
+    uint16_t count = (uint16_t)MIN(candidate_count, (size_t)DICT_MAX_ENTRIES);
+    for (uint16_t i = 0; i < count; i++) {
+        entry_of_rule[candidates[i].rule] = i;
+    }
+
+    Dictionary* dict = allocDictionary(count);
+    for (uint16_t i = 0; dict && i < count; i++) {
+        const RepairRule* rule = &grammar.rules[candidates[i].rule];
+        BinarySequence* entry = &dict->entries[i];
+        entry->sequence = malloc(rule->length);
+        if (!entry->sequence) {
+            dictionary_free(dict);
+            dict = NULL;
+            break;
+        }
+        dict->count++;
+        entry->length = (int)repair_expand(&grammar, REPAIR_FIRST_RULE + candidates[i].rule,
+                                           entry->sequence, rule->length);
+        entry->frequency = (int)rule->count;
+        entry->isRule = dictionarySymbol(rule->left, entry_of_rule, &entry->left) &&
+                        dictionarySymbol(rule->right, entry_of_rule, &entry->right);
+    }
+    free(candidates);
+    free(entry_of_rule);
+    repair_free(&grammar);
+
+    if (dict && !buildIndex(dict)) {
+        dictionary_free(dict);
+        return NULL;
+    }
+    if (dict) dictionary_update_id(dict);
+    return dict;
+}
+
+void dictionary_update_id(Dictionary* dict) {
+    if (!dict) return;
+
+    XXH32_state_t* state = XXH32_createState();
+    if (!state) return;
+    XXH32_reset(state, 0);
+    XXH32_update(state, &dict->layout.group_count, 1);
+    XXH32_update(state, dict->layout.code_bits, dict->layout.group_count);
+    for (uint16_t i = 0; i < dict->count; i++) {
+        const BinarySequence* entry = &dict->entries[i];
+        uint8_t meta[4] = {(uint8_t)entry->length, entry->group,
+                           (uint8_t)(entry->codeword >> 8), (uint8_t)(entry->codeword & 0xFF)};
+        XXH32_update(state, meta, sizeof(meta));
+        XXH32_update(state, entry->sequence, entry->length);
+    }
+    dict->id = XXH32_digest(state);
+    XXH32_freeState(state);
+}
+
+const PerfectHashSlot* dictionary_find(const Dictionary* dict, const uint8_t* sequence, uint16_t length) {
+    if (!dict || !sequence || !dictionary_may_match(dict, sequence[0], length)) return NULL;
+    return perfect_hash_find(dict->frozen, sequence, length);
+}
+
+BinarySequence* dictionary_lookup(const Dictionary* dict, const uint8_t* sequence, uint16_t length) {
+    const PerfectHashSlot* slot = dictionary_find(dict, sequence, length);
+    return slot ? &dict->entries[slot->record.entry] : NULL;
+}
+
+void dictionary_freeze(Dictionary* dict) {
+    if (!dict || !dict->frozen) return;
+    perfect_hash_update_codes(dict->frozen, dict->entries);
+    // Keys are all in the map already, so this does not allocate
+    if (dict->records) updateRecords(dict);
+}
+
+void dictionary_set_savings(Dictionary* dict, const int32_t* savings) {
+    if (!dict || !dict->frozen || !savings) return;
+    perfect_hash_update_savings(dict->frozen, savings);
+    if (dict->records) updateRecords(dict);
+}
+
+int dictionary_build_records(Dictionary* dict) {
+    if (!dict || !dict->frozen) return 0;
+    if (dict->records) return 1;
+    dict->records = binseq_map_create(dict->count + dict->count / 4 + 16);
+    return dict->records && updateRecords(dict);
+}
+
+void dictionary_free(Dictionary* dict) {
+    if (!dict) return;
+    for (uint16_t i = 0; i < dict->count; i++) {
+        free(dict->entries[i].sequence);
+    }
+    free(dict->entries);
+    binseq_map_free(dict->records);
+    perfect_hash_free(dict->frozen);
+    free(dict);
+}
+
+/*
+ * File layout (big-endian, like the compressed stream):
+ *    - 4-byte magic "TKDC", 1-byte version
+ *    - 4-byte dictionary id
+ *    - 2-byte entry count
+ *    - 1-byte group count, then the codeword width of each group
+ *    - For each entry: 1-byte length, 1-byte form, then
+ *        form DICT_FORM_BYTES: N bytes of sequence data
+ *        form DICT_FORM_PAIR:  2-byte left and 2-byte right pair symbols
+ *      followed by 1-byte group, 2-byte codeword, 4-byte training frequency
+ */
+int dictionary_save(const Dictionary* dict, const char* filename) {
+    if (!dict || !filename) return 0;
+
+    FILE* file = fopen(filename, "wb");
+    if (!file) {
+        perror("Failed to open dictionary file");
+        return 0;
+    }
+
+    uint8_t header[11];
+    memcpy(header, DICT_MAGIC, 4);
+    header[4] = DICT_FORMAT_VERSION;
+    header[5] = dict->id >> 24;
+    header[6] = (dict->id >> 16) & 0xFF;
+    header[7] = (dict->id >> 8) & 0xFF;
+    header[8] = dict->id & 0xFF;
+    header[9] = dict->count >> 8;
+    header[10] = dict->count & 0xFF;
+    int ok = fwrite(header, 1, sizeof(header), file) == sizeof(header) &&
+             fwrite(&dict->layout.group_count, 1, 1, file) == 1 &&
+             fwrite(dict->layout.code_bits, 1, dict->layout.group_count, file) == dict->layout.group_count;
+
+    for (uint16_t i = 0; ok && i < dict->count; i++) {
+        const BinarySequence* entry = &dict->entries[i];
+        uint32_t freq = (uint32_t)entry->frequency;
+        uint8_t meta[7] = {entry->group, entry->codeword >> 8, entry->codeword & 0xFF,
+                           freq >> 24, (freq >> 16) & 0xFF, (freq >> 8) & 0xFF, freq & 0xFF};
+        // A pair only pays off once it is shorter than the bytes it stands for
+        if (entry->isRule && entry->length > 4) {
+            uint8_t pair[6] = {(uint8_t)entry->length, DICT_FORM_PAIR,
+                               entry->left >> 8, entry->left & 0xFF,
+                               entry->right >> 8, entry->right & 0xFF};
+            ok = fwrite(pair, 1, sizeof(pair), file) == sizeof(pair);
+        } else {
+            uint8_t prefix[2] = {(uint8_t)entry->length, DICT_FORM_BYTES};
+            ok = fwrite(prefix, 1, sizeof(prefix), file) == sizeof(prefix) &&
+                 fwrite(entry->sequence, 1, entry->length, file) == (size_t)entry->length;
+        }
+        ok = ok && fwrite(meta, 1, sizeof(meta), file) == sizeof(meta);
+    }
+
+    if (fclose(file) != 0) ok = 0;
+    if (!ok) fprintf(stderr, "Error: Failed to write dictionary %s\n", filename);
+    return ok;
+}
+
+// Expands a pair entry (and the entries it refers to) into its bytes
+static int flattenEntry(Dictionary* dict, uint16_t index, int depth) {
+    BinarySequence* entry = &dict->entries[index];
+    if (entry->sequence) return 1;
+    if (!entry->isRule || depth > SEQ_LENGTH_LIMIT) return 0;
+
+    entry->sequence = malloc(entry->length);
+    if (!entry->sequence) return 0;
+
+    int offset = 0;
+    uint16_t symbols[2] = {entry->left, entry->right};
+    for (int s = 0; s < 2; s++) {
+        if (symbols[s] < DICT_SYMBOL_BASE) {
+            if (offset + 1 > entry->length) return 0;
+            entry->sequence[offset++] = (uint8_t)symbols[s];
+            continue;
+        }
+        uint16_t child = symbols[s] - DICT_SYMBOL_BASE;
+        if (child >= dict->count || !flattenEntry(dict, child, depth + 1)) return 0;
+        const BinarySequence* part = &dict->entries[child];
+        if (offset + part->length > entry->length) return 0;
+        memcpy(entry->sequence + offset, part->sequence, part->length);
+        offset += part->length;
+    }
+    return offset == entry->length;
+}
+
+Dictionary* dictionary_load(const char* filename) {
+    FILE* file = fopen(filename, "rb");
+    if (!file) {
+        perror("Failed to open dictionary file");
+        return NULL;
+    }
+
+    uint8_t header[11];
+    if (fread(header, 1, sizeof(header), file) != sizeof(header) ||
+        memcmp(header, DICT_MAGIC, 4) != 0 || header[4] != DICT_FORMAT_VERSION) {
+        fprintf(stderr, "Error: %s is not a dictionary file\n", filename);
+        fclose(file);
+        return NULL;
+    }
+
+    uint16_t count = (header[9] << 8) | header[10];
+    if (count > DICT_MAX_ENTRIES) {
+        fprintf(stderr, "Error: Dictionary %s has too many entries (%u)\n", filename, count);
+        fclose(file);
+        return NULL;
+    }
+
+    Dictionary* dict = allocDictionary(count);
+    if (!dict) {
+        fclose(file);
+        return NULL;
+    }
+    dict->id = ((uint32_t)header[5] << 24) | ((uint32_t)header[6] << 16) |
+               ((uint32_t)header[7] << 8) | header[8];
+
+    GroupLayout* layout = &dict->layout;
+    if (fread(&layout->group_count, 1, 1, file) != 1 ||
+        layout->group_count == 0 || layout->group_count > TOTAL_GROUPS ||
+        fread(layout->code_bits, 1, layout->group_count, file) != layout->group_count) {
+        goto error_cleanup;
+    }
+    for (uint8_t g = 0; g < layout->group_count; g++) {
+        if (layout->code_bits[g] > GROUP_MAX_CODE_BITS) goto error_cleanup;
+    }
+
+    // Entries without data yet are freed safely on error
+    dict->count = count;
+    for (uint16_t i = 0; i < count; i++) {
+        BinarySequence* entry = &dict->entries[i];
+        uint8_t prefix[2];
+        uint8_t meta[7];
+        if (fread(prefix, 1, sizeof(prefix), file) != sizeof(prefix) ||
+            prefix[0] < SEQ_LENGTH_START || prefix[0] > SEQ_LENGTH_LIMIT) {
+            goto error_cleanup;
+        }
+        entry->length = prefix[0];
+        if (prefix[1] == DICT_FORM_PAIR) {
+            uint8_t pair[4];
+            if (fread(pair, 1, sizeof(pair), file) != sizeof(pair)) goto error_cleanup;
+            entry->isRule = 1;
+            entry->left = (pair[0] << 8) | pair[1];
+            entry->right = (pair[2] << 8) | pair[3];
+        } else if (prefix[1] == DICT_FORM_BYTES) {
+            entry->sequence = malloc(entry->length);
+            if (!entry->sequence ||
+                fread(entry->sequence, 1, entry->length, file) != (size_t)entry->length) {
+                goto error_cleanup;
+            }
+        } else {
+            goto error_cleanup;
+        }
+        if (fread(meta, 1, sizeof(meta), file) != sizeof(meta)) goto error_cleanup;
+        entry->group = meta[0];
+        entry->codeword = (meta[1] << 8) | meta[2];
+        entry->frequency = (int)(((uint32_t)meta[3] << 24) | ((uint32_t)meta[4] << 16) |
+                                 ((uint32_t)meta[5] << 8) | meta[6]);
+        if (entry->group >= layout->group_count ||
+            entry->codeword >> groupCodeSize(layout, entry->group)) {
+            goto error_cleanup;
+        }
+    }
+    fclose(file);
+
+    for (uint16_t i = 0; i < count; i++) {
+        if (!flattenEntry(dict, i, 0)) {
+            fprintf(stderr, "Error: Dictionary %s has an invalid pair entry\n", filename);
+            dictionary_free(dict);
+            return NULL;
+        }
+    }
+
+    if (!buildIndex(dict)) {
+        dictionary_free(dict);
+        return NULL;
+    }
+    return dict;
+
+error_cleanup:
+    fprintf(stderr, "Error: Dictionary %s is truncated or corrupted\n", filename);
+    fclose(file);
+    dictionary_free(dict);
+    return NULL;
+}
@@ -0,0 +1,106 @@
+// first_pass/dictionary.h
+#ifndef DICTIONARY_H
+#define DICTIONARY_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "../constants.h"
+#include "../common_types.h"
+#include "../second_pass/binseq_hashmap.h"
+#include "../second_pass/group.h"
+#include "../second_pass/perfect_hash.h"
+
+#define DICT_MAGIC "TKDC"
+#define DICT_FORMAT_VERSION 3
+#define DICT_SYMBOL_BASE 256       // Pair symbols >= this refer to entry (symbol - DICT_SYMBOL_BASE)
+#define DICT_FORM_BYTES 0          // Entry stored as its bytes
+#define DICT_FORM_PAIR 1           // Entry stored as two pair symbols
+#define DICT_MAX_ENTRIES 4144      // Capacity of the default group layout
+#define DICT_MIN_FREQUENCY 2       // Sequences seen fewer times are never candidates
+#define DICT_REFERENCE_MARKER 0xFFFF // Header count meaning "stream uses a shared dictionary"
+#define DICT_STORED_MARKER 0xFFFE    // Header count meaning "the input follows as is"
+#define DICT_FILTER_BITS_PER_KEY 16 // Bloom filter size for callers that probe the records map
+#define DICT_MAX_CANDIDATES (7 << 18) // Sequences counted at once, a full 2^21-slot map
+
+/**
+ * Dictionary selected by the first pass.
+ * Entries are ranked best first; layout, group and codeword are assigned by the
+ * caller after training and are stored as-is when the dictionary is saved.
+ */
+typedef struct {
+    BinarySequence* entries;   // Ranked entries, each owning its sequence bytes
+    uint16_t count;            // Number of valid entries
+    uint32_t id;               // Content hash, recorded in streams that reference the dictionary
+    GroupLayout layout;        // Codeword widths of the groups the entries are assigned to
+    BinSeqMap* records;        // sequence -> record of its entry, NULL until dictionary_build_records
+    uint64_t lengths_present;  // SEQ_LENGTH_BIT of every entry length
+    uint64_t lengths_by_first_byte[256];  // Same, per first byte of the entries
+    PerfectHash* frozen;       // Same records in a perfect hash (used by the parse and the writer)
+} Dictionary;
+
+/**
+ * Counts every repeated sequence of length SEQ_LENGTH_START..SEQ_LENGTH_LIMIT in the
+ * samples and keeps the DICT_MAX_ENTRIES with the highest estimated bit savings.
+ * @param samples Sample buffers to train on
+ * @param sample_sizes Size of each sample buffer
+ * @param sample_count Number of samples
+ * @param shared True when the dictionary is stored outside the stream, so entries
+ *               do not pay for their header bits
+ * @param stats Count the lookups of the candidate map and print them when done
+ * @return Trained dictionary (possibly empty), or NULL on allocation failure
+ */
+Dictionary* dictionary_train(const uint8_t* const* samples, const size_t* sample_sizes,
+                             int sample_count, bool shared, bool stats);
+
+/**
+ * Same selection as dictionary_train, but the repeated sequences and their exact
+ * occurrence counts come from one sweep over the suffix and LCP arrays of the
+ * samples instead of a hash count per length.
+ */
+Dictionary* dictionary_train_suffix_array(const uint8_t* const* samples, const size_t* sample_sizes,
+                                          int sample_count, bool shared);
+
+/**
+ * Builds the dictionary from a Re-Pair grammar of the samples instead of independent
+ * counts. Entries whose halves are also entries keep that pair, so a saved dictionary
+ * can store them as two references instead of their bytes.
+ * Rules expanding beyond SEQ_LENGTH_LIMIT are not selected, the parse cannot emit them.
+ * @param stats Count the lookups of the grammar's pair index and print them when done
+ */
+Dictionary* dictionary_train_repair(const uint8_t* const* samples, const size_t* sample_sizes,
+                                    int sample_count, bool shared, bool stats);
+
+// Recomputes id from the layout and entries; call after group/codeword assignment.
+void dictionary_update_id(Dictionary* dict);
+
+int dictionary_save(const Dictionary* dict, const char* filename);
+Dictionary* dictionary_load(const char* filename);
+void dictionary_free(Dictionary* dict);
+
+// False when no entry of length starts with first_byte, so a lookup is bound to miss.
+static inline bool dictionary_may_match(const Dictionary* dict, uint8_t first_byte, uint16_t length) {
+    return length >= SEQ_LENGTH_START && length <= SEQ_LENGTH_LIMIT &&
+           (dict->lengths_by_first_byte[first_byte] & SEQ_LENGTH_BIT(length));
+}
+
+// Returns the entry for the sequence, or NULL if it is not in the dictionary.
+BinarySequence* dictionary_lookup(const Dictionary* dict, const uint8_t* sequence, uint16_t length);
+
+// Same lookup, returning the slot of the frozen table with the entry's group and codeword.
+const PerfectHashSlot* dictionary_find(const Dictionary* dict, const uint8_t* sequence, uint16_t length);
+
+// Copies frequency, group and codeword of the entries into their records; call after they change.
+void dictionary_freeze(Dictionary* dict);
+
+// Sets the saving of one use of each entry in its records; savings is indexed by entry.
+void dictionary_set_savings(Dictionary* dict, const int32_t* savings);
+
+/**
+ * Fills dict->records, which the parse does not use and which is therefore not
+ * built with the dictionary; it then follows dictionary_freeze and dictionary_set_savings.
+ * @return 1 on success, 0 on allocation failure
+ */
+int dictionary_build_records(Dictionary* dict);
+
+#endif
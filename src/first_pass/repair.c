@@ -0,0 +1,314 @@
+// first_pass/repair.c
+
+#include "repair.h"
+#include "../second_pass/binseq_hashmap.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define SYMBOL_SEPARATOR UINT32_MAX        // Between samples, never part of a pair
+#define SYMBOL_DELETED (UINT32_MAX - 1)    // Second half of a replaced pair
+#define NONE (-1)
+
+// All occurrences of one pair, plus its place in the frequency buckets
+typedef struct {
+    uint32_t left;
+    uint32_t right;
+    uint32_t count;
+    int32_t first;          // Head of the occurrence list
+    int32_t bucket_prev;
+    int32_t bucket_next;
+} PairRecord;
+
+typedef struct {
+    uint32_t* sym;          // Current symbol at each position
+    int32_t* next;          // Next live position
+    int32_t* prev;          // Previous live position
+    int32_t* occ_next;      // Occurrence list of the pair starting here
+    int32_t* occ_prev;
+    int32_t* occ_record;    // Record of the pair counted at this position, or NONE
+    size_t length;
+
+    PairRecord* records;
+    size_t record_count;
+    size_t record_capacity;
+    BinSeqMap* pair_index;  // (left, right) -> record index
+
+    int32_t* buckets;       // buckets[c] lists the pairs occurring c times
+    uint32_t bucket_count;
+    uint32_t min_count;
+} RepairState;
+
+static int isPairSymbol(uint32_t symbol) {
+    return symbol != SYMBOL_SEPARATOR && symbol != SYMBOL_DELETED;
+}
+
+static void bucketRemove(RepairState* st, int32_t r) {
+    PairRecord* rec = &st->records[r];
+    if (rec->count < st->min_count) return;
+    if (rec->bucket_prev != NONE) {
+        st->records[rec->bucket_prev].bucket_next = rec->bucket_next;
+    } else {
+        st->buckets[rec->count] = rec->bucket_next;
+    }
+    if (rec->bucket_next != NONE) {
+        st->records[rec->bucket_next].bucket_prev = rec->bucket_prev;
+    }
+}
+
+static void bucketInsert(RepairState* st, int32_t r) {
+    PairRecord* rec = &st->records[r];
+    if (rec->count < st->min_count) return;
+    rec->bucket_prev = NONE;
+    rec->bucket_next = st->buckets[rec->count];
+    if (rec->bucket_next != NONE) {
+        st->records[rec->bucket_next].bucket_prev = r;
+    }
+    st->buckets[rec->count] = r;
+}
+
+static int32_t findRecord(RepairState* st, uint32_t left, uint32_t right) {
+    uint32_t key[2] = {left, right};
+    const int* index = binseq_map_get_frequency(st->pair_index, (const uint8_t*)key, sizeof(key));
+    if (index) return *index;
+
+    if (st->record_count == st->record_capacity) {
+        size_t new_capacity = st->record_capacity * 2;
+        PairRecord* grown = realloc(st->records, new_capacity * sizeof(PairRecord));
+        if (!grown) return NONE;
+        st->records = grown;
+        st->record_capacity = new_capacity;
+    }
+    int32_t r = (int32_t)st->record_count;
+    if (!binseq_map_put(st->pair_index, (const uint8_t*)key, sizeof(key), r)) return NONE;
+
+    PairRecord* rec = &st->records[st->record_count++];
+    rec->left = left;
+    rec->right = right;
+    rec->count = 0;
+    rec->first = NONE;
+    rec->bucket_prev = rec->bucket_next = NONE;
+    return r;
+}
+
+static int sameRecordAt(const RepairState* st, int32_t pos, uint32_t left, uint32_t right) {
+    if (pos == NONE || st->occ_record[pos] == NONE) return 0;
+    const PairRecord* rec = &st->records[st->occ_record[pos]];
+    return rec->left == left && rec->right == right;
+}
+
+// Counts the pair starting at pos, unless it overlaps a counted occurrence of itself ("aaa")
+static int addOccurrence(RepairState* st, int32_t pos) {
+    int32_t nxt = st->next[pos];
+    if (nxt == NONE) return 1;
+    uint32_t left = st->sym[pos];
+    uint32_t right = st->sym[nxt];
+    if (!isPairSymbol(left) || !isPairSymbol(right)) return 1;
+    if (left == right &&
+        (sameRecordAt(st, st->prev[pos], left, right) || sameRecordAt(st, nxt, left, right))) {
+        return 1;
+    }
+
+    int32_t r = findRecord(st, left, right);
+    if (r == NONE) return 0;
+    PairRecord* rec = &st->records[r];
+
+    st->occ_record[pos] = r;
+    st->occ_prev[pos] = NONE;
+    st->occ_next[pos] = rec->first;
+    if (rec->first != NONE) st->occ_prev[rec->first] = pos;
+    rec->first = pos;
+
+    bucketRemove(st, r);
+    rec->count++;
+    bucketInsert(st, r);
+    return 1;
+}
+
+static void removeOccurrence(RepairState* st, int32_t pos) {
+    if (pos == NONE) return;
+    int32_t r = st->occ_record[pos];
+    if (r == NONE) return;
+    PairRecord* rec = &st->records[r];
+
+    if (st->occ_prev[pos] != NONE) {
+        st->occ_next[st->occ_prev[pos]] = st->occ_next[pos];
+    } else {
+        rec->first = st->occ_next[pos];
+    }
+    if (st->occ_next[pos] != NONE) {
+        st->occ_prev[st->occ_next[pos]] = st->occ_prev[pos];
+    }
+    st->occ_record[pos] = NONE;
+
+    bucketRemove(st, r);
+    rec->count--;
+    bucketInsert(st, r);
+}
+
+// Replaces every counted occurrence of record r by symbol
+static int replacePair(RepairState* st, int32_t r, uint32_t symbol) {
+    int32_t pos = st->records[r].first;
+    while (pos != NONE) {
+        int32_t next_occ = st->occ_next[pos];
+        int32_t right = st->next[pos];
+        int32_t before = st->prev[pos];
+        int32_t after = st->next[right];
+
+        removeOccurrence(st, before);
+        removeOccurrence(st, right);
+        removeOccurrence(st, pos);
+
+        st->sym[pos] = symbol;
+        st->sym[right] = SYMBOL_DELETED;
+        st->next[pos] = after;
+        if (after != NONE) st->prev[after] = pos;
+
+        if (before != NONE && !addOccurrence(st, before)) return 0;
+        if (!addOccurrence(st, pos)) return 0;
+        pos = next_occ;
+    }
+    return 1;
+}
+
+static void freeState(RepairState* st) {
+    free(st->sym);
+    free(st->next);
+    free(st->prev);
+    free(st->occ_next);
+    free(st->occ_prev);
+    free(st->occ_record);
+    free(st->records);
+    free(st->buckets);
+    binseq_map_free(st->pair_index);
+}
+
+static int initState(RepairState* st, const uint8_t* const* samples, const size_t* sample_sizes,
+                     int sample_count, uint32_t min_count, bool stats) {
+    memset(st, 0, sizeof(*st));
+    for (int s = 0; s < sample_count; s++) {
+        st->length += sample_sizes[s] + 1;
+    }
+    if (st->length >= INT32_MAX) {
+        fprintf(stderr, "Error: Re-Pair samples are too large\n");
+        return 0;
+    }
+
+    size_t n = st->length;
+    st->sym = malloc(n * sizeof(uint32_t));
+    st->next = malloc(n * sizeof(int32_t));
+    st->prev = malloc(n * sizeof(int32_t));
+    st->occ_next = malloc(n * sizeof(int32_t));
+    st->occ_prev = malloc(n * sizeof(int32_t));
+    st->occ_record = malloc(n * sizeof(int32_t));
+    st->record_capacity = 1024;
+    st->records = malloc(st->record_capacity * sizeof(PairRecord));
+    // Non-overlapping occurrences of a pair never exceed half the positions
+    st->bucket_count = (uint32_t)(n / 2 + 2);
+    st->buckets = malloc(st->bucket_count * sizeof(int32_t));
+    st->pair_index = binseq_map_create(1 << 16);
+    st->min_count = min_count < 2 ? 2 : min_count;
+    if (!st->sym || !st->next || !st->prev || !st->occ_next || !st->occ_prev ||
+        !st->occ_record || !st->records || !st->buckets || !st->pair_index) {
+        return 0;
+    }
+    if (stats && !binseq_map_enable_stats(st->pair_index)) return 0;
+
+    size_t pos = 0;
+    for (int s = 0; s < sample_count; s++) {
+        for (size_t i = 0; i < sample_sizes[s]; i++) {
+            st->sym[pos++] = samples[s][i];
+        }
+        st->sym[pos++] = SYMBOL_SEPARATOR;
+    }
+    for (size_t i = 0; i < n; i++) {
+        st->next[i] = (i + 1 < n) ? (int32_t)(i + 1) : NONE;
+        st->prev[i] = (i > 0) ? (int32_t)(i - 1) : NONE;
+        st->occ_record[i] = NONE;
+    }
+    for (uint32_t c = 0; c < st->bucket_count; c++) {
+        st->buckets[c] = NONE;
+    }
+    for (size_t i = 0; i < n; i++) {
+        if (!addOccurrence(st, (int32_t)i)) return 0;
+    }
+    return 1;
+}
+
+int repair_build(const uint8_t* const* samples, const size_t* sample_sizes, int sample_count,
+                 uint32_t min_count, bool stats, RepairGrammar* grammar) {
+    if (!samples || !sample_sizes || sample_count <= 0 || !grammar) return 0;
+    memset(grammar, 0, sizeof(*grammar));
+
+    RepairState st;
+    if (!initState(&st, samples, sample_sizes, sample_count, min_count, stats)) {
+        freeState(&st);
+        return 0;
+    }
+
+    uint32_t rule_capacity = 1024;
+    grammar->rules = malloc(rule_capacity * sizeof(RepairRule));
+    if (!grammar->rules) {
+        freeState(&st);
+        return 0;
+    }
+
+    /*
+     * A new pair always contains the new symbol, so it cannot occur more often
+     * than the pair just replaced: the highest non-empty bucket only moves down.
+     */
+    uint32_t top = st.bucket_count - 1;
+    while (1) {
+        while (top >= st.min_count && st.buckets[top] == NONE) top--;
+        if (top < st.min_count) break;
+
+        int32_t r = st.buckets[top];
+        if (grammar->count == rule_capacity) {
+            rule_capacity *= 2;
+            RepairRule* grown = realloc(grammar->rules, rule_capacity * sizeof(RepairRule));
+            if (!grown) goto error_cleanup;
+            grammar->rules = grown;
+        }
+
+        RepairRule* rule = &grammar->rules[grammar->count];
+        rule->left = st.records[r].left;
+        rule->right = st.records[r].right;
+        rule->count = st.records[r].count;
+        rule->length = (rule->left < REPAIR_FIRST_RULE ? 1 : grammar->rules[rule->left - REPAIR_FIRST_RULE].length) +
+                       (rule->right < REPAIR_FIRST_RULE ? 1 : grammar->rules[rule->right - REPAIR_FIRST_RULE].length);
+
+        if (!replacePair(&st, r, REPAIR_FIRST_RULE + grammar->count)) goto error_cleanup;
+        grammar->count++;
+    }
+
+    binseq_map_print_stats(st.pair_index, "Re-Pair pairs");
+    freeState(&st);
+    return 1;
+
+error_cleanup:
+    fprintf(stderr, "Error: Re-Pair ran out of memory\n");
+    freeState(&st);
+    repair_free(grammar);
+    return 0;
+}
+
+size_t repair_expand(const RepairGrammar* grammar, uint32_t symbol, uint8_t* out, size_t max_length) {
+    if (symbol < REPAIR_FIRST_RULE) {
+        if (max_length < 1) return 0;
+        out[0] = (uint8_t)symbol;
+        return 1;
+    }
+
+    const RepairRule* rule = &grammar->rules[symbol - REPAIR_FIRST_RULE];
+    if (rule->length > max_length) return 0;
+    size_t left = repair_expand(grammar, rule->left, out, max_length);
+    size_t right = repair_expand(grammar, rule->right, out + left, max_length - left);
+    return left + right;
+}
+
+void repair_free(RepairGrammar* grammar) {
+    if (!grammar) return;
+    free(grammar->rules);
+    grammar->rules = NULL;
+    grammar->count = 0;
+}
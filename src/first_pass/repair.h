@@ -0,0 +1,43 @@
+// first_pass/repair.h
+#ifndef REPAIR_H
+#define REPAIR_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define REPAIR_FIRST_RULE 256  // Symbols below are bytes, symbol REPAIR_FIRST_RULE + r is rule r
+
+// Rule r of the grammar: symbol REPAIR_FIRST_RULE + r expands to left followed by right
+typedef struct {
+    uint32_t left;      // First symbol of the pair
+    uint32_t right;     // Second symbol of the pair
+    uint32_t length;    // Length of the full expansion in bytes
+    uint32_t count;     // Non-overlapping occurrences replaced when the rule was created
+} RepairRule;
+
+typedef struct {
+    RepairRule* rules;
+    uint32_t count;
+} RepairGrammar;
+
+/**
+ * Builds a Re-Pair grammar over the samples: the most frequent pair of adjacent
+ * symbols is replaced by a new rule until no pair occurs min_count times.
+ * Runs in time linear in the total sample size (Larsson & Moffat), pairs never
+ * span two samples.
+ * @param stats Count the lookups of the pair index and print them when done
+ * @return 1 on success, 0 on allocation failure
+ */
+int repair_build(const uint8_t* const* samples, const size_t* sample_sizes, int sample_count,
+                 uint32_t min_count, bool stats, RepairGrammar* grammar);
+
+/**
+ * Writes the expansion of symbol into out.
+ * @return Number of bytes written, or 0 if the expansion is longer than max_length
+ */
+size_t repair_expand(const RepairGrammar* grammar, uint32_t symbol, uint8_t* out, size_t max_length);
+
+void repair_free(RepairGrammar* grammar);
+
+#endif
@@ -0,0 +1,158 @@
+// first_pass/suffix_array.c
+
+#include "suffix_array.h"
+#include <stdlib.h>
+#include <stdbool.h>
+
+#define EMPTY (-1)
+
+// type[i] is 1 for an S-type suffix (smaller than the next one), 0 for L-type
+#define IS_LMS(type, i) ((i) > 0 && (type)[i] && !(type)[(i) - 1])
+
+// Start (end == false) or end (end == true) of each symbol's bucket in sa
+static void getBuckets(const int32_t* text, int32_t n, int32_t alphabet_max, int32_t* bucket, bool end) {
+    for (int32_t c = 0; c <= alphabet_max; c++) bucket[c] = 0;
+    for (int32_t i = 0; i < n; i++) bucket[text[i]]++;
+    int32_t sum = 0;
+    for (int32_t c = 0; c <= alphabet_max; c++) {
+        sum += bucket[c];
+        bucket[c] = end ? sum : sum - bucket[c];
+    }
+}
+
+// Places L-type suffixes from the sorted ones already in sa, left to right
+static void induceL(const uint8_t* type, int32_t* sa, const int32_t* text, int32_t n,
+                    int32_t alphabet_max, int32_t* bucket) {
+    getBuckets(text, n, alphabet_max, bucket, false);
+    for (int32_t i = 0; i < n; i++) {
+        int32_t j = sa[i] - 1;
+        if (sa[i] > 0 && !type[j]) sa[bucket[text[j]]++] = j;
+    }
+}
+
+// Places S-type suffixes from the L-type ones, right to left
+static void induceS(const uint8_t* type, int32_t* sa, const int32_t* text, int32_t n,
+                    int32_t alphabet_max, int32_t* bucket) {
+    getBuckets(text, n, alphabet_max, bucket, true);
+    for (int32_t i = n - 1; i >= 0; i--) {
+        int32_t j = sa[i] - 1;
+        if (sa[i] > 0 && type[j]) sa[--bucket[text[j]]] = j;
+    }
+}
+
+int suffix_array_build(const int32_t* text, int32_t* sa, int32_t n, int32_t alphabet_max) {
+    if (n < 2) {
+        if (n == 1) sa[0] = 0;
+        return 1;
+    }
+
+    uint8_t* type = malloc(n);
+    int32_t* bucket = malloc(((size_t)alphabet_max + 1) * sizeof(int32_t));
+    if (!type || !bucket) {
+        free(type);
+        free(bucket);
+        return 0;
+    }
+
+    type[n - 1] = 1;
+    type[n - 2] = 0;
+    for (int32_t i = n - 3; i >= 0; i--) {
+        type[i] = (text[i] < text[i + 1] || (text[i] == text[i + 1] && type[i + 1])) ? 1 : 0;
+    }
+
+    // 1. Sort the LMS substrings by inducing from their bucket ends
+    getBuckets(text, n, alphabet_max, bucket, true);
+    for (int32_t i = 0; i < n; i++) sa[i] = EMPTY;
+    for (int32_t i = 1; i < n; i++) {
+        if (IS_LMS(type, i)) sa[--bucket[text[i]]] = i;
+    }
+    induceL(type, sa, text, n, alphabet_max, bucket);
+    induceS(type, sa, text, n, alphabet_max, bucket);
+
+    // 2. Name the sorted LMS substrings; equal substrings share a name
+    int32_t lms_count = 0;
+    for (int32_t i = 0; i < n; i++) {
+        if (IS_LMS(type, sa[i])) sa[lms_count++] = sa[i];
+    }
+    for (int32_t i = lms_count; i < n; i++) sa[i] = EMPTY;
+
+    int32_t names = 0;
+    int32_t previous = EMPTY;
+    for (int32_t i = 0; i < lms_count; i++) {
+        int32_t pos = sa[i];
+        bool differs = false;
+        for (int32_t d = 0; d < n; d++) {
+            if (previous == EMPTY || text[pos + d] != text[previous + d] ||
+                type[pos + d] != type[previous + d]) {
+                differs = true;
+                break;
+            }
+            if (d > 0 && (IS_LMS(type, pos + d) || IS_LMS(type, previous + d))) break;
+        }
+        if (differs) {
+            names++;
+            previous = pos;
+        }
+        // LMS positions are at least two apart, so pos / 2 does not collide
+        sa[lms_count + pos / 2] = names - 1;
+    }
+    for (int32_t i = n - 1, j = n - 1; i >= lms_count; i--) {
+        if (sa[i] >= 0) sa[j--] = sa[i];
+    }
+
+    // 3. Sort the reduced string, recursing while names are not unique
+    int32_t* reduced = sa + n - lms_count;
+    int32_t* reduced_sa = sa;
+    int result = 1;
+    if (names < lms_count) {
+        result = suffix_array_build(reduced, reduced_sa, lms_count, names - 1);
+    } else {
+        for (int32_t i = 0; i < lms_count; i++) reduced_sa[reduced[i]] = i;
+    }
+
+    // 4. Induce the full order from the sorted LMS suffixes
+    if (result) {
+        getBuckets(text, n, alphabet_max, bucket, true);
+        for (int32_t i = 1, j = 0; i < n; i++) {
+            if (IS_LMS(type, i)) reduced[j++] = i;
+        }
+        for (int32_t i = 0; i < lms_count; i++) reduced_sa[i] = reduced[reduced_sa[i]];
+        for (int32_t i = lms_count; i < n; i++) sa[i] = EMPTY;
+        for (int32_t i = lms_count - 1; i >= 0; i--) {
+            int32_t j = sa[i];
+            sa[i] = EMPTY;
+            sa[--bucket[text[j]]] = j;
+        }
+        induceL(type, sa, text, n, alphabet_max, bucket);
+        induceS(type, sa, text, n, alphabet_max, bucket);
+    }
+
+    free(type);
+    free(bucket);
+    return result;
+}
+
+int suffix_array_lcp(const int32_t* text, const int32_t* sa, int32_t* lcp, int32_t n,
+                     int32_t stop_symbol) {
+    int32_t* rank = malloc((size_t)n * sizeof(int32_t));
+    if (!rank) return 0;
+    for (int32_t i = 0; i < n; i++) rank[sa[i]] = i;
+
+    // The prefix shared with the previous suffix shrinks by at most one per step
+    int32_t h = 0;
+    lcp[0] = 0;
+    for (int32_t i = 0; i < n; i++) {
+        if (rank[i] == 0) {
+            h = 0;
+            continue;
+        }
+        int32_t j = sa[rank[i] - 1];
+        while (i + h < n && j + h < n && text[i + h] == text[j + h] && text[i + h] > stop_symbol) {
+            h++;
+        }
+        lcp[rank[i]] = h;
+        if (h > 0) h--;
+    }
+    free(rank);
+    return 1;
+}
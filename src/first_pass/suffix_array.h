@@ -0,0 +1,25 @@
+// first_pass/suffix_array.h
+#ifndef SUFFIX_ARRAY_H
+#define SUFFIX_ARRAY_H
+
+#include <stdint.h>
+
+/**
+ * Builds the suffix array of text with SA-IS (Nong, Zhang & Chan), in linear time.
+ * @param text Symbols in 0..alphabet_max; the last one must be 0 and appear nowhere else
+ * @param sa Receives the start of each suffix in sorted order, n entries
+ * @param n Length of text, at least 2
+ * @param alphabet_max Largest symbol of text
+ * @return 1 on success, 0 on allocation failure
+ */
+int suffix_array_build(const int32_t* text, int32_t* sa, int32_t n, int32_t alphabet_max);
+
+/**
+ * Fills lcp[i] with the longest common prefix of suffixes sa[i-1] and sa[i] (Kasai),
+ * lcp[0] is 0. Symbols <= stop_symbol never match, so no prefix runs over them.
+ * @return 1 on success, 0 on allocation failure
+ */
+int suffix_array_lcp(const int32_t* text, const int32_t* sa, int32_t* lcp, int32_t n,
+                     int32_t stop_symbol);
+
+#endif
@@ -2,26 +2,39 @@
 
 #include "graph.h"
 #include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 // Global graph instance initialized to zero
 Graph graph = {0};
 
-// Initialize the graph structure
+/**
+ * Initialize the graph structure. The first call clears all of it; later calls
+ * only clear the nodes of the previous block and their index slots, a node
+ * staying in the slot of the level and weight it was created with.
+ */
 void graph_init(void) {
-    //if (graph.initialized) return;  // Only initialize once
-
-    // Clear the entire graph structure
-    memset(&graph, 0, sizeof(graph));
-    
-    // Initialize node IDs
-    for (uint32_t i = 0; i < GRAPH_MAX_NODES; i++) {
-        graph.nodes[i].id = i;
+    if (graph.initialized) {
+        for (uint32_t i = 0; i < graph.current_node_index; i++) {
+            GraphNode* node = &graph.nodes[i];
+            graph.index.slots[node->level][node->incoming_weight].count = 0;
+            node->parent_count = 0;
+            node->child_count = 0;
+            node->incoming_weight = 0;
+            node->compress_start_index = 0;
+            node->compress_sequence = 0;
+            node->saving_so_far = 0;
+            node->level = 0;
+        }
+        graph.current_node_index = 0;
+        memset(graph.weight_cache, 0, sizeof(graph.weight_cache));
+        graph.index.max_level = 0;
+        return;
     }
-    memset(graph.weight_cache, 0, sizeof(graph.weight_cache));
-    
-    // Set initial max level and mark as initialized
-    graph.index.max_level = 0;
+
+    // The graph has static storage and starts out zeroed; writing it here would
+    // fault in every page of the node array before the first block is parsed.
+    // Node ids are set as the nodes are created.
     graph.initialized = true;
 }
 
@@ -70,6 +83,7 @@ GraphNode* create_new_node(uint8_t weight, uint32_t level) {
     }
 
     GraphNode* node = &graph.nodes[graph.current_node_index];
+    node->id = graph.current_node_index;
     node->incoming_weight = weight;
     node->level = level;
 
@@ -110,6 +124,69 @@ uint32_t get_max_level(void) {
     return graph.index.max_level;
 }
 
+// Parent with the highest saving, or NULL for the root
+static GraphNode* best_parent(const GraphNode* node) {
+    GraphNode* best = NULL;
+    for (uint8_t i = 0; i < node->parent_count; i++) {
+        GraphNode* parent = graph_get_node(node->parents[i]);
+        if (parent && (!best || parent->saving_so_far > best->saving_so_far)) {
+            best = parent;
+        }
+    }
+    return best;
+}
+
+/**
+ * Walks back from the most saving node of the last level and appends the token
+ * lengths of that parse to path, in input order.
+ * A node of compress_sequence L ends a token covering L bytes, so the walk steps
+ * back L levels; the literal nodes it skips are the bytes the token absorbed.
+ */
+bool graph_best_path(CompressPath* path) {
+    if (!path || graph.current_node_index == 0) return false;
+
+    uint32_t level = graph.index.max_level;
+    GraphNode* cur = NULL;
+    for (uint8_t w = 0; w < SEQ_LENGTH_LIMIT; w++) {
+        WeightLevelSlot* slot = &graph.index.slots[level][w];
+        for (uint8_t i = 0; i < slot->count; i++) {
+            GraphNode* node = &graph.nodes[slot->indices[i]];
+            if (!cur || node->saving_so_far > cur->saving_so_far) cur = node;
+        }
+    }
+
+    // A block has at most `level` tokens
+    if (path->compress_sequence_count + level > path->capacity) {
+        uint32_t new_capacity = MAX(path->capacity * 2, path->compress_sequence_count + level);
+        uint8_t* grown = realloc(path->compress_sequence, new_capacity);
+        if (!grown) {
+            fprintf(stderr, "Error: Unable to grow compress path\n");
+            return false;
+        }
+        path->compress_sequence = grown;
+        path->capacity = new_capacity;
+    }
+
+    uint8_t* tokens = &path->compress_sequence[path->compress_sequence_count];
+    uint32_t token_count = 0;
+    while (cur) {
+        uint8_t len = cur->compress_sequence;
+        tokens[token_count++] = len;
+        for (uint8_t step = 0; step < len && cur; step++) {
+            cur = best_parent(cur);
+        }
+    }
+
+    // Tokens were collected back to front
+    for (uint32_t i = 0; i < token_count / 2; i++) {
+        uint8_t tmp = tokens[i];
+        tokens[i] = tokens[token_count - 1 - i];
+        tokens[token_count - 1 - i] = tmp;
+    }
+    path->compress_sequence_count += token_count;
+    return true;
+}
+
 // Print detailed information about a graph node
 void print_graph_node(const GraphNode *node, const uint8_t* block) {
     if (!node) {
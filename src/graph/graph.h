@@ -4,11 +4,12 @@
 #define GRAPH_NODE_H
 
 #include "../constants.h"
+#include "../common_types.h"
 #include <stdint.h>
 #include <stdbool.h>
 
 // Graph configuration constants
-#define MAX_LEVELS BLOCK_SIZE  // Maximum number of levels in the graph
+#define MAX_LEVELS (BLOCK_SIZE + 1)  // Levels start at 1, so a full block needs BLOCK_SIZE + 1
 #define GRAPH_MAX_NODES ((MAX_LEVELS+1)*(SEQ_LENGTH_LIMIT+1))    // Maximum number of nodes in the graph
 
 // Compile-time assertion macro for different C standards
@@ -81,5 +82,6 @@ void print_graph_node(const GraphNode *node, const uint8_t* block);  // Print no
 uint32_t get_current_graph_node_index(void);  // Get current node index
 const uint32_t* get_nodes_by_weight_and_level(uint8_t weight, uint32_t level, uint32_t* count);  // Query nodes by weight/level
 uint32_t get_max_level(void);  // Get maximum level in graph
+bool graph_best_path(CompressPath* path);  // Append the most saving parse of the block to path
 
 #endif
\ No newline at end of file
@@ -6,36 +6,143 @@
 #include <stdio.h>
 #include <limits.h>
 #include <math.h>
-//#include "write_in_file/write_in_file.h"
+#include "write_in_file/write_in_file.h"
+#include "read_file/read_file.h"
+#include "first_pass/dictionary.h"
 #include "second_pass/group.h"
 #include "graph/graph.h"
 #include "second_pass/prune_logic.h"
+#include "second_pass/aho_corasick.h"
+#include "second_pass/match_table.h"
+#include "second_pass/seq_compare.h"
 
 #ifdef DEBUG
 GraphVisualizer viz;
 #endif
 
-uint16_t total_codes = 0;
+// Dictionary the second pass compresses against
+static Dictionary* dictionary = NULL;
+
+// Finds the dictionary entries ending at each byte of a block
+static AhoCorasick* matcher = NULL;
+
+// Dictionary entries ending at each byte of the block being processed
+static MatchTable match_table;
+
+// How the parse values a dictionary match. A model is whatever fills
+// entry_savings in computeEntrySavings; the parse reads only that array.
+typedef enum {
+    COST_MODEL,  // Table of the power savings model, by length and training frequency
+    COST_BITS    // Exact bits saved against literals, header share included
+} CostModel;
+
+// Saving of one use of each dictionary entry, read by processCompressPath
+static int32_t* entry_savings = NULL;
 
 static void processNodePath(uint32_t old_node_index, const uint8_t* block, uint32_t block_size, uint32_t block_index,    
     const uint8_t* sequence, uint8_t seq_len, uint8_t new_weight);
 
-static inline uint8_t getCurrentGroup() {
-    if (total_codes < getGroupThreshold(0)) {
+// Entries being ranked by assignGroupsByUses, and whether by training frequency
+static const BinarySequence* ranking_entries = NULL;
+static bool ranking_by_frequency = false;
+
+static uint32_t entryUses(const BinarySequence* entry) {
+    return (uint32_t)(ranking_by_frequency ? entry->frequency : entry->count);
+}
+
+static int compareUses(const void* a, const void* b) {
+    uint16_t ia = *(const uint16_t*)a;
+    uint16_t ib = *(const uint16_t*)b;
+    uint32_t ua = entryUses(&ranking_entries[ia]);
+    uint32_t ub = entryUses(&ranking_entries[ib]);
+    if (ua != ub) {
+        return ua > ub ? -1 : 1;
+    }
+    return (int)ia - (int)ib;
+}
+
+/**
+ * Ranks entries by uses, highest first, picks the group layout for that ranking
+ * and hands out groups and codewords in rank order.
+ * After the parse, uses are the tokens using each entry (count, see calcUsedSequences)
+ * and only used entries get a codeword. For a shared dictionary they are the training
+ * frequencies and every entry gets a codeword, any of them may be used later.
+ */
+static int assignGroupsByUses(Dictionary* dict, bool training) {
+    uint16_t slots = dict->count ? dict->count : 1;
+    uint16_t *order = malloc(slots * sizeof(uint16_t));
+    uint32_t *uses = malloc(slots * sizeof(uint32_t));
+    if (!order || !uses) {
+        fprintf(stderr, "Error: Unable to allocate codeword ranking\n");
+        free(order);
+        free(uses);
         return 0;
-    } else if (total_codes < getGroupThreshold(1)) {
-        return 1;
-    } else if (total_codes < getGroupThreshold(2)) {
-        return 2;
-    } else if (total_codes < getGroupThreshold(3)) {
-        return 3;
-    } else {
-        fprintf(stderr, "\n Out of codes \n");
-        exit(EXIT_FAILURE);
-    } 
+    }
+
+    ranking_entries = dict->entries;
+    ranking_by_frequency = training;
+    for (uint16_t i = 0; i < dict->count; i++) {
+        order[i] = i;
+    }
+    qsort(order, dict->count, sizeof(uint16_t), compareUses);
+
+    uint16_t coded = 0;
+    for (uint16_t i = 0; i < dict->count; i++) {
+        uses[i] = entryUses(&dict->entries[order[i]]);
+        if (training || uses[i] > 0) coded++;
+    }
+
+    int result = groupLayoutOptimal(uses, coded, &dict->layout);
+    for (uint16_t i = 0; result && i < dict->count; i++) {
+        BinarySequence* entry = &dict->entries[order[i]];
+        entry->codeword = 0;
+        entry->group = (i < coded) ? getGroupOfRank(&dict->layout, i, &entry->codeword) : GROUP_UNASSIGNED;
+    }
+    if (result) {
+        dictionary_update_id(dict);
+        dictionary_freeze(dict);
+    }
+
+    ranking_entries = NULL;
+    free(order);
+    free(uses);
+    return result;
 }
 
+/**
+ * Fills entry_savings for the next parse.
+ * With COST_BITS a use saves the literal bits of the entry minus its token bits.
+ * A self-trained dictionary is first given a layout ranked by training frequency
+ * (the final one follows the uses of the parse) and its entries also pay their
+ * header bits, spread over their training frequency.
+ */
+static int computeEntrySavings(CostModel model, bool shared) {
+    int32_t* savings = realloc(entry_savings, (dictionary->count ? dictionary->count : 1) * sizeof(int32_t));
+    if (!savings) {
+        fprintf(stderr, "Error: Unable to allocate entry savings\n");
+        return 0;
+    }
+    entry_savings = savings;
 
+    if (model == COST_BITS && !shared && !assignGroupsByUses(dictionary, true)) {
+        return 0;
+    }
+    const GroupLayout* layout = &dictionary->layout;
+    for (uint16_t i = 0; i < dictionary->count; i++) {
+        const BinarySequence* entry = &dictionary->entries[i];
+        if (model == COST_MODEL) {
+            entry_savings[i] = calculate_savings_for_frequency((uint16_t)entry->length, entry->frequency);
+        } else if (entry->group >= layout->group_count) {
+            entry_savings[i] = 0;  // No codeword, only literals
+        } else {
+            uint8_t token_bits = groupOverHead(layout) + groupCodeSize(layout, entry->group);
+            entry_savings[i] = calculate_bit_savings((uint16_t)entry->length, token_bits,
+                                                     shared ? 0 : MAX(entry->frequency, 1));
+        }
+    }
+    dictionary_set_savings(dictionary, entry_savings);
+    return 1;
+}
 
 /*
 static int updateMapValue(TreeNode *node, const uint8_t* sequence, uint16_t seq_len) {
@@ -60,20 +167,72 @@ static int updateMapValue(TreeNode *node, const uint8_t* sequence, uint16_t seq_
 }
 */
 
+/**
+ * Adds the compressed path ending at block_index.
+ * Every compressed node of a level has weight 0 (no pending literals left), so they
+ * all describe the same state and only the candidate with the highest total saving
+ * gets a node. A sequence of seq_len can follow any node with weight >= seq_len-1.
+ * Candidates are the dictionary entries ending at block_index, read from match_table.
+ */
 static void processCompressPath(const uint8_t* block, uint32_t block_size, uint32_t block_index,    
-    const uint8_t* sequence, uint8_t seq_len, uint32_t current_level) {
-    
-    uint32_t seq_start_offset = block_index + 1 - seq_len;
-    if (seq_start_offset >= block_size || (seq_start_offset + seq_len) > block_size) {
-        fprintf(stderr,"\n invalid seq_start \n");
+    uint32_t current_level) {
+    (void)block; // Only printed in debug builds
+    // Lengths of the entries ending here, without those starting before the block
+    uint64_t all_lengths = match_table.length_mask[block_index];
+    uint64_t lengths = all_lengths;
+    if (current_level + 1 < SEQ_LENGTH_LIMIT) {
+        lengths &= SEQ_LENGTH_BIT(current_level + 2) - 1;
+    }
+    if (!lengths) {
         return;
     }
-    
-    int32_t new_saving = calculate_savings(sequence, seq_len, NULL);
-    if (new_saving == INT_MIN) {
+    uint8_t max_weight = (uint8_t)MIN(current_level, (uint32_t)SEQ_LENGTH_LIMIT - 1);
+    int min_weight = __builtin_ctzll(lengths) + SEQ_LENGTH_START - 1;
+
+    // best_from[w] is the representative with the highest saving among weights >= w
+    uint32_t best_from[SEQ_LENGTH_LIMIT + 1];
+    best_from[max_weight + 1] = UINT32_MAX;
+    for (int w = max_weight; w >= min_weight; w--) {
+        uint32_t candidate = graph.weight_cache[w].first_node_with_weight;
+        best_from[w] = best_from[w + 1];
+        if (candidate != UINT32_MAX &&
+            (best_from[w] == UINT32_MAX ||
+             graph_get_node(candidate)->saving_so_far > graph_get_node(best_from[w])->saving_so_far)) {
+            best_from[w] = candidate;
+        }
+    }
+
+    int64_t best_saving = 0;
+    uint8_t best_len = 0;
+    // Entries are stored longest first, the order of the set bits from the top
+    uint32_t match = match_table.first_match[block_index] + __builtin_popcountll(all_lengths ^ lengths);
+    for (; lengths; match++) {
+        int bit = 63 - __builtin_clzll(lengths);
+        lengths &= ~(1ULL << bit);
+        uint16_t seq_len = (uint16_t)(bit + SEQ_LENGTH_START);
+        uint32_t parent = best_from[seq_len - 1];
+        if (parent == UINT32_MAX) {
+            continue;
+        }
+        uint32_t seq_start_offset = block_index + 1 - seq_len;
+        if (seq_start_offset >= block_size || (seq_start_offset + seq_len) > block_size) {
+            fprintf(stderr,"\n invalid seq_start \n");
+            return;
+        }
+
+        int32_t saving = entry_savings[match_table.entries[match]];
+        if (saving <= 0) {
+            continue;
+        }
+        int64_t total = (int64_t)saving + graph_get_node(parent)->saving_so_far;
+        if (total > best_saving) {
+            best_saving = total;
+            best_len = (uint8_t)seq_len;
+        }
+    }
+    if (best_len == 0) {
         return;
     }
-    //todo new_saving += old_node->saving_so_far;
             
     uint8_t weight = 0;
     
@@ -87,26 +246,22 @@ static void processCompressPath(const uint8_t* block, uint32_t block_size, uint3
 
     // SET NODE PROPERTIES
     new_node->incoming_weight = weight;
-    new_node->saving_so_far = new_saving;
-    new_node->compress_sequence = seq_len;
+    new_node->saving_so_far = (uint32_t)MIN(best_saving, (int64_t)INT32_MAX);
+    new_node->compress_sequence = best_len;
     new_node->level = current_level+1;
-    new_node->compress_start_index = seq_start_offset;
+    new_node->compress_start_index = block_index + 1 - best_len;
     
 #ifdef DEBUG
     print_graph_node(new_node, block);
 #endif
-    for (uint8_t parent_weight = seq_len - 1;
-         parent_weight < SEQ_LENGTH_LIMIT &&
-         parent_weight <= (uint8_t)current_level;
-         parent_weight++) {
-        uint32_t count;
-        const uint32_t *indexes = get_nodes_by_weight_and_level(parent_weight, current_level, &count);
-        if (count == 0) {
+    for (uint8_t parent_weight = best_len - 1; parent_weight <= max_weight; parent_weight++) {
+        uint32_t parent = graph.weight_cache[parent_weight].first_node_with_weight;
+        if (parent == UINT32_MAX) {
             continue;
         }
         // ADD EDGE AFTER NODE IS FULLY INITIALIZED
-        if (!graph_add_edge(indexes[0], new_node->id)) {
-            fprintf(stderr, "Failed to add edge from %u to %u\n", indexes[0],
+        if (!graph_add_edge(parent, new_node->id)) {
+            fprintf(stderr, "Failed to add edge from %u to %u\n", parent,
                     new_node->id);
             return;
         }
@@ -128,7 +283,7 @@ static void processNodePath(uint32_t old_node_index, const uint8_t* block, uint3
         return;
     }
     
-    int32_t new_saving = calculate_savings(sequence, seq_len, NULL);
+    int32_t new_saving = calculate_savings(sequence, seq_len);
     if (new_saving == INT_MIN) {
         return;
     }
@@ -203,7 +358,7 @@ static inline void createRoot(const uint8_t* block, uint32_t block_size) {
         exit(EXIT_FAILURE);
     }
     */
-    root->saving_so_far = calculate_savings(&block[0], 1, NULL);
+    root->saving_so_far = calculate_savings(&block[0], 1);
 
     #ifdef DEBUG
     printf("\nCreated new root node in pool[0][0]:\n");
@@ -220,6 +375,11 @@ static void processBlock(const uint8_t *block, uint32_t block_size) {
         return;
     }
 
+    // Find every dictionary match of the block before building its graph
+    if (!match_table_fill(&match_table, matcher, block, block_size)) {
+        exit(EXIT_FAILURE);
+    }
+
     // Create the root node
     createRoot(block, block_size);
 
@@ -239,83 +399,231 @@ static void processBlock(const uint8_t *block, uint32_t block_size) {
             
             if (node_count == 0) continue;
 
-            for (uint32_t i = 0; i < node_count; i++) {
-                uint32_t node_idx = node_indices[i];
-                GraphNode *old_node = graph_get_node(node_idx);
-                if (!old_node) {
-                    fprintf(stderr, "Error: Null node encountered at index %u\n", node_idx);
+            // The node with the highest saving represents this weight. The others
+            // describe the same state with less saving and only share its children.
+            uint32_t rep_idx = node_indices[0];
+            for (uint32_t i = 1; i < node_count; i++) {
+                GraphNode *node = graph_get_node(node_indices[i]);
+                if (!node) {
+                    fprintf(stderr, "Error: Null node encountered at index %u\n", node_indices[i]);
                     continue;
                 }
+                if (node->saving_so_far > graph_get_node(rep_idx)->saving_so_far) {
+                    rep_idx = node_indices[i];
+                }
+            }
+            GraphNode *rep_node = graph_get_node(rep_idx);
+            if (!rep_node) {
+                fprintf(stderr, "Error: Null node encountered at index %u\n", rep_idx);
+                continue;
+            }
+            graph.weight_cache[weight].first_node_with_weight = rep_idx;
+            graph.weight_cache[weight].weight = weight;
 
-                // Check if we've already processed this weight
-                if (graph.weight_cache[weight].first_node_with_weight != UINT32_MAX && 
-                    graph.weight_cache[weight].first_node_with_weight != node_idx)  {
-                    // Reuse children from first node with same weight
-                    GraphNode *first_node = graph_get_node(graph.weight_cache[weight].first_node_with_weight);
-                    if (!first_node) {
-                        fprintf(stderr, "Error: Null first node for weight %u\n", weight);
-                        continue;
-                    }
-                    
-                    // Link to existing children
-                    for (uint8_t c = 0; c < first_node->child_count; c++) {
-                        if (!graph_add_edge(node_idx, first_node->children[c])) {
-                            fprintf(stderr, "Failed to add reused edge from %u to %u\n", 
-                                    node_idx, first_node->children[c]);
-                        }
-                    }
+            // Uncompressed path (weight increases by 1)
+            processNodePath(rep_idx, block, block_size, block_index,
+                          &block[block_index], 1, rep_node->incoming_weight + 1);
+
+            // Link the other nodes of this weight to the same children
+            for (uint32_t i = 0; i < node_count; i++) {
+                uint32_t node_idx = node_indices[i];
+                if (node_idx == rep_idx) {
                     continue;
                 }
-
-                // Only set first_node_with_weight if not already set
-                if (graph.weight_cache[weight].first_node_with_weight == UINT32_MAX) {
-                    graph.weight_cache[weight].first_node_with_weight = node_idx;
-                    graph.weight_cache[weight].weight = weight;
+                for (uint8_t c = 0; c < rep_node->child_count; c++) {
+                    if (!graph_add_edge(node_idx, rep_node->children[c])) {
+                        fprintf(stderr, "Failed to add reused edge from %u to %u\n", 
+                                node_idx, rep_node->children[c]);
+                    }
                 }
-
-                // Process paths only for first node with this weight
-                
-                // Uncompressed path (weight increases by 1)
-                processNodePath(node_idx, block, block_size, block_index,
-                              &block[block_index], 1, old_node->incoming_weight + 1);
-                
             }
         }
-        // Compressed paths (various sequence lengths)
-        for (uint16_t seq_len = 2; seq_len <= current_level+1 && seq_len <= SEQ_LENGTH_LIMIT; seq_len++) {          
-            const uint8_t *seq_start = &block[block_index + 1 - seq_len];
-            processCompressPath(block, block_size, block_index, seq_start, seq_len, current_level);
-        }
+        // Compressed paths (dictionary entries ending here)
+        processCompressPath(block, block_size, block_index, current_level);
     }
 }
 
-int main(int argc, char *argv[]) {
-    if (argc != 2) {
-        // printf("Usage: %s <input_file> <output_file>\n", argv[0]);
-        printf("Usage: %s <input_file>\n", argv[0]);
-        return 1;
+static void printUsage(const char* program) {
+    printf("Usage: %s [-D <dictionary_file>] [--reparse] [--bit-cost] [--stats] <input_file> <output_file>\n", program);
+    printf("       %s --train [--repair | --hash-count] [--stats] <dictionary_file> <sample_file>...\n", program);
+}
+
+// How the first pass finds its candidate sequences
+typedef enum {
+    TRAIN_SUFFIX_ARRAY,  // Repeats and exact counts from a suffix array sweep
+    TRAIN_HASH_COUNT,    // Hash count of every length, level by level
+    TRAIN_REPAIR         // Rules of a Re-Pair grammar
+} TrainMethod;
+
+// Trains a dictionary on the samples with method; stats prints the lookups of its map
+static Dictionary* trainWith(TrainMethod method, const uint8_t* const* samples, const size_t* sample_sizes,
+                             int sample_count, bool shared, bool stats) {
+    switch (method) {
+        case TRAIN_HASH_COUNT:
+            return dictionary_train(samples, sample_sizes, sample_count, shared, stats);
+        case TRAIN_REPAIR:
+            return dictionary_train_repair(samples, sample_sizes, sample_count, shared, stats);
+        default:
+            return dictionary_train_suffix_array(samples, sample_sizes, sample_count, shared);
     }
+}
 
-    FILE *file = fopen(argv[1], "rb");
-    if (!file) {
-        perror("Failed to open file");
-        return 1;
+/**
+ * Builds a shared dictionary from the sample files and saves it to dict_file.
+ * @param method How candidate sequences are found: suffix array (default), hash
+ *               counts per length, or the rules of a Re-Pair grammar
+ * @param stats Print the lookup counters of the hash count or Re-Pair map
+ * @return 0 on success, 1 on failure (the exit code of --train)
+ */
+static int trainDictionary(const char* dict_file, char** sample_files, int sample_count,
+                           TrainMethod method, bool stats) {
+    uint8_t **samples = calloc(sample_count, sizeof(uint8_t*));
+    size_t *sample_sizes = calloc(sample_count, sizeof(size_t));
+    int result = 1;
+    if (!samples || !sample_sizes) {
+        perror("Failed to allocate memory for samples");
+        goto cleanup;
     }
 
-    uint8_t *block = malloc(BLOCK_SIZE);
-    if (!block) {
-        perror("Failed to allocate memory for block");
-        fclose(file);
-        return 1;
+    for (int i = 0; i < sample_count; i++) {
+        samples[i] = readWholeFile(sample_files[i], &sample_sizes[i]);
+        if (!samples[i]) goto cleanup;
+    }
+
+    Dictionary *dict = trainWith(method, (const uint8_t* const*)samples, sample_sizes, sample_count, true, stats);
+    if (!dict) goto cleanup;
+    if (assignGroupsByUses(dict, true) && dictionary_save(dict, dict_file)) {
+        printf("Trained dictionary %s: %u entries, id %08X\n", dict_file, dict->count, dict->id);
+        result = 0;
     }
+    dictionary_free(dict);
 
-    while (1) {
-        long bytesRead = fread(block, 1, BLOCK_SIZE, file);
-        if (bytesRead <= 0)
+cleanup:
+    for (int i = 0; samples && i < sample_count; i++) {
+        free(samples[i]);
+    }
+    free(samples);
+    free(sample_sizes);
+    return result;
+}
+
+// Runs of one byte at least this long skip the graph and are parsed in closed form
+#define RUN_MIN_LENGTH (2 * SEQ_LENGTH_LIMIT)
+// Run tail left to the exact parse; past it the best parse only repeats the densest token
+#define RUN_DP_SPAN (SEQ_LENGTH_LIMIT * SEQ_LENGTH_LIMIT)
+
+// Scratch of the run tail parse: best saving and last token of each tail length
+static int64_t run_best[RUN_DP_SPAN + SEQ_LENGTH_LIMIT + 1];
+static uint8_t run_choice[RUN_DP_SPAN + SEQ_LENGTH_LIMIT + 1];
+
+// Makes room for count more tokens in path
+static int reservePath(CompressPath* path, size_t count) {
+    if (path->compress_sequence_count + count <= path->capacity) return 1;
+    size_t new_capacity = MAX((size_t)path->capacity * 2, path->compress_sequence_count + count);
+    if (new_capacity > UINT32_MAX) {
+        fprintf(stderr, "Error: Compress path too long\n");
+        return 0;
+    }
+    uint8_t* grown = realloc(path->compress_sequence, new_capacity);
+    if (!grown) {
+        fprintf(stderr, "Error: Unable to grow compress path\n");
+        return 0;
+    }
+    path->compress_sequence = grown;
+    path->capacity = (uint32_t)new_capacity;
+    return 1;
+}
+
+/**
+ * @return Length of the run of data[0] starting at data, at most size
+ */
+static size_t runLength(const uint8_t* data, size_t size) {
+    uint64_t pattern = data[0] * 0x0101010101010101ULL;
+    size_t i = 0;
+    while (i + 8 <= size) {
+        uint64_t diff = seq_load64(data + i) ^ pattern;
+        if (diff) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+            return i + (size_t)__builtin_ctzll(diff) / 8;
+#else
             break;
+#endif
+        }
+        i += 8;
+    }
+    while (i < size && data[i] == data[0]) i++;
+    return i;
+}
+
+/**
+ * Appends the best parse of a run of length bytes to path without building its graph.
+ * Every token of a run is the same whatever its position, so the parse is a knapsack
+ * over token lengths: the run is filled with the token saving the most per byte, and
+ * only the last RUN_DP_SPAN or so bytes are parsed exactly. Totals saturate at
+ * INT32_MAX as a node's saving does, and ties go to the longer token, as in the graph.
+ */
+static int parseRun(const uint8_t* run, size_t length, CompressPath* path) {
+    int64_t saving[SEQ_LENGTH_LIMIT + 1] = {0};
+    bool usable[SEQ_LENGTH_LIMIT + 1] = {false};
+    usable[1] = true;  // A literal saves nothing
+    uint16_t densest = 1;
+    bool saturated = false;
+    for (uint16_t k = SEQ_LENGTH_START; k <= SEQ_LENGTH_LIMIT && k <= length; k++) {
+        if (!dictionary_may_match(dictionary, run[0], k)) continue;
+        const PerfectHashSlot* slot = dictionary_find(dictionary, run, k);
+        if (!slot || slot->record.savings <= 0) continue;
+        usable[k] = true;
+        saving[k] = slot->record.savings;
+        saturated |= saving[k] == INT32_MAX;
+        // Once one token saturates the total, fewer tokens is all that is left to win
+        if (saturated || saving[k] * densest >= saving[densest] * k) densest = k;
+    }
+
+    size_t repeats = length > RUN_DP_SPAN ? (length - RUN_DP_SPAN) / densest : 0;
+    size_t tail = length - repeats * densest;
+
+    run_best[0] = 0;
+    for (size_t i = 1; i <= tail; i++) {
+        run_best[i] = INT64_MIN;
+        for (uint16_t k = (uint16_t)MIN((size_t)SEQ_LENGTH_LIMIT, i); k >= 1; k--) {
+            if (!usable[k] || run_best[i - k] == INT64_MIN) continue;
+            int64_t total = MIN(run_best[i - k] + saving[k], (int64_t)INT32_MAX);
+            if (total > run_best[i]) {
+                run_best[i] = total;
+                run_choice[i] = (uint8_t)k;
+            }
+        }
+    }
+
+    size_t tail_tokens = 0;
+    for (size_t i = tail; i > 0; i -= run_choice[i]) tail_tokens++;
+    if (!reservePath(path, repeats + tail_tokens)) return 0;
+
+    uint8_t* tokens = &path->compress_sequence[path->compress_sequence_count];
+    memset(tokens, (int)densest, repeats);
+    tokens += repeats;
+    for (size_t i = tail; i > 0; i -= run_choice[i]) *tokens++ = run_choice[i];
+    path->compress_sequence_count += (uint32_t)(repeats + tail_tokens);
+    return 1;
+}
+
+/**
+ * Runs the second pass over data[start, end), the bytes between two runs, and appends
+ * the best parse of each block to path. Blocks keep to the BLOCK_SIZE grid of data,
+ * so input without runs is cut as it always was.
+ */
+static int parseSegment(const uint8_t* data, size_t start, size_t end, CompressPath* path) {
+    for (size_t offset = start; offset < end;) {
+        uint32_t bytesRead = (uint32_t)MIN(BLOCK_SIZE - offset % BLOCK_SIZE, end - offset);
+        const uint8_t *block = data + offset;
 
         // process of block of file at a time.
         processBlock(block, bytesRead);
+        if (!graph_best_path(path)) {
+            fprintf(stderr, "Error: Unable to find a path for block at %zu\n", offset);
+            return 0;
+        }
+        offset += bytesRead;
 
 #ifdef DEBUG
     graphviz_init(&viz, "compression_tree.dot", true);
@@ -324,11 +632,176 @@ int main(int argc, char *argv[]) {
     graphviz_finalize(&viz);
 #endif
     }
+    return 1;
+}
+
+/**
+ * Runs the second pass over data and appends its best parse to path. Runs of one
+ * byte of RUN_MIN_LENGTH or more are parsed by parseRun, the rest by the graph.
+ */
+static int parseInput(const uint8_t* data, size_t size, CompressPath* path) {
+    size_t segment = 0;
+    size_t offset = 0;
+    while (offset < size) {
+        size_t run = runLength(data + offset, size - offset);
+        if (run >= RUN_MIN_LENGTH) {
+            if (!parseSegment(data, segment, offset, path) ||
+                !parseRun(data + offset, run, path)) {
+                return 0;
+            }
+            segment = offset + run;
+        }
+        offset += run;
+    }
+    return parseSegment(data, segment, size, path);
+}
+
+// Compares the bits counted for the parse with the size of the written file
+static void printBitAccounting(const char* output_file, bool shared, const CompressPath* path,
+                               const uint8_t* data, size_t size) {
+    StreamBits bits;
+    uint64_t expected = countCompressedBits(dictionary, shared, path, data, size, &bits);
+    long written = -1;
+    FILE* file = fopen(output_file, "rb");
+    if (file) {
+        if (fseek(file, 0, SEEK_END) == 0) written = ftell(file);
+        fclose(file);
+    }
+    // Parses larger than a stored copy are written as one
+    bool stored = expected > storedOutputSize(size);
+    printf("Bit accounting: %llu header bits, %llu data bits (%llu saved against literals), "
+           "%llu bytes expected%s, %ld written\n",
+           (unsigned long long)bits.header_bits, (unsigned long long)bits.data_bits,
+           (unsigned long long)((uint64_t)size * LITERAL_BITS - bits.data_bits),
+           (unsigned long long)(stored ? storedOutputSize(size) : expected), stored ? " (stored)" : "",
+           written);
+}
+
+/**
+ * Compresses input_file into output_file. With a dict_file the stream only
+ * references that dictionary; otherwise a dictionary is trained on the input
+ * itself (first pass) and its used entries go into the header, with the group
+ * layout and codewords chosen from their actual uses. With reparse, the input is parsed a second time with
+ * each entry weighted by its uses in the first parse. cost_model sets how the parse
+ * values matches. With stats, prints the compare kernel and checks the bit accounting
+ * against the written file.
+ */
+static int compressFile(const char* input_file, const char* output_file, const char* dict_file,
+                        bool reparse, CostModel cost_model, bool stats) {
+    size_t size = 0;
+    uint8_t *data = readWholeFile(input_file, &size);
+    if (!data) {
+        return 1;
+    }
+
+    bool shared = dict_file != NULL;
+    if (shared) {
+        dictionary = dictionary_load(dict_file);
+    } else {
+        const uint8_t *samples[1] = {data};
+        dictionary = trainWith(TRAIN_SUFFIX_ARRAY, samples, &size, 1, false, false);
+    }
+    if (!dictionary) {
+        fprintf(stderr, "Error: No dictionary available\n");
+        free(data);
+        return 1;
+    }
+    matcher = aho_corasick_build(dictionary->entries, dictionary->count);
+    if (!matcher) {
+        fprintf(stderr, "Error: Unable to build the dictionary matcher\n");
+        dictionary_free(dictionary);
+        dictionary = NULL;
+        free(data);
+        return 1;
+    }
 
-    free(block);
-    block = NULL;
+    CompressPath path = {0};
+    int parsed = computeEntrySavings(cost_model, shared) && parseInput(data, size, &path);
 
-    fclose(file);
+    // Codewords of a shared dictionary are fixed by the dictionary file
+    if (parsed && !shared) {
+        calcUsedSequences(&path, data, size, dictionary);
+        if (reparse) {
+            for (uint16_t i = 0; i < dictionary->count; i++) {
+                BinarySequence *entry = &dictionary->entries[i];
+                entry->frequency = entry->count;
+            }
+            dictionary_freeze(dictionary);
+            path.compress_sequence_count = 0;
+            parsed = computeEntrySavings(cost_model, shared) && parseInput(data, size, &path);
+            calcUsedSequences(&path, data, size, dictionary);
+        }
+        parsed = parsed && assignGroupsByUses(dictionary, false);
+    }
+
+    int written = parsed && writeCompressedOutput(output_file, dictionary, shared, &path, data, size);
+    if (written && stats) {
+        printf("Compare kernel: %s\n", seq_compare_kernel());
+        printBitAccounting(output_file, shared, &path, data, size);
+    }
+
+    free(path.compress_sequence);
+    free(entry_savings);
+    entry_savings = NULL;
+    aho_corasick_free(matcher);
+    matcher = NULL;
+    match_table_free(&match_table);
+    dictionary_free(dictionary);
+    dictionary = NULL;
+    free(data);
+    return written ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc >= 4 && strcmp(argv[1], "--train") == 0) {
+        TrainMethod method = TRAIN_SUFFIX_ARRAY;
+        bool stats = false;
+        int first = 2;
+        while (first < argc && argv[first][0] == '-') {
+            if (strcmp(argv[first], "--repair") == 0) {
+                method = TRAIN_REPAIR;
+            } else if (strcmp(argv[first], "--hash-count") == 0) {
+                method = TRAIN_HASH_COUNT;
+            } else if (strcmp(argv[first], "--stats") == 0) {
+                stats = true;
+            } else {
+                break;
+            }
+            first++;
+        }
+        if (argc - first < 2) {
+            printUsage(argv[0]);
+            return 1;
+        }
+        return trainDictionary(argv[first], &argv[first + 1], argc - first - 1, method, stats);
+    }
+
+    const char *dict_file = NULL;
+    bool reparse = false;
+    bool stats = false;
+    CostModel cost_model = COST_MODEL;
+    int arg = 1;
+    while (arg < argc && argv[arg][0] == '-') {
+        if (strcmp(argv[arg], "-D") == 0 && arg + 1 < argc) {
+            dict_file = argv[arg + 1];
+            arg += 2;
+        } else if (strcmp(argv[arg], "--reparse") == 0) {
+            reparse = true;
+            arg++;
+        } else if (strcmp(argv[arg], "--bit-cost") == 0) {
+            cost_model = COST_BITS;
+            arg++;
+        } else if (strcmp(argv[arg], "--stats") == 0) {
+            stats = true;
+            arg++;
+        } else {
+            break;
+        }
+    }
+    if (argc - arg != 2) {
+        printUsage(argv[0]);
+        return 1;
+    }
 
-    return 0;
+    return compressFile(argv[arg], argv[arg + 1], dict_file, reparse, cost_model, stats);
 }
@@ -0,0 +1,36 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "read_file.h"
+#include "../constants.h"
+
+uint8_t* readWholeFile(const char* filename, size_t* size) {
+    FILE *file = fopen(filename, "rb");
+    if (!file) {
+        perror("Failed to open file");
+        return NULL;
+    }
+
+    size_t capacity = BLOCK_SIZE;
+    size_t used = 0;
+    uint8_t *data = malloc(capacity);
+    while (data) {
+        size_t bytesRead = fread(data + used, 1, capacity - used, file);
+        used += bytesRead;
+        if (used < capacity) break;
+
+        uint8_t *grown = realloc(data, capacity * 2);
+        if (!grown) {
+            free(data);
+            data = NULL;
+            break;
+        }
+        data = grown;
+        capacity *= 2;
+    }
+    if (!data) {
+        perror("Failed to allocate memory for file");
+    }
+    fclose(file);
+    *size = used;
+    return data;
+}
@@ -0,0 +1,15 @@
+//read_file.h
+#ifndef READ_FILE_H
+#define READ_FILE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * Reads a whole file into a newly allocated buffer.
+ * @param size Receives the number of bytes read
+ * @return The buffer (caller frees), or NULL on failure
+ */
+uint8_t* readWholeFile(const char* filename, size_t* size);
+
+#endif
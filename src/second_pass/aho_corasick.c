@@ -0,0 +1,165 @@
+// aho_corasick.c
+#include "aho_corasick.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+#define NO_STATE UINT32_MAX
+#define NO_ENTRY (-1)
+
+typedef struct {
+    uint32_t fail;          // Longest proper suffix that is also a state
+    uint32_t output;        // Nearest state on the failure chain that ends an entry
+    uint32_t first_child;
+    uint32_t next_sibling;
+    int32_t entry;          // Entry ending here, or NO_ENTRY
+    uint8_t label;          // Byte leading here from the parent
+    uint8_t depth;
+} AcState;
+
+struct AhoCorasick {
+    AcState* states;
+    uint32_t count;
+    uint32_t capacity;
+    uint32_t root_next[256];  // Goto of the root, dense since every scan passes through it
+};
+
+static uint32_t findChild(const AhoCorasick* ac, uint32_t state, uint8_t byte) {
+    if (state == AC_ROOT) return ac->root_next[byte];
+    for (uint32_t child = ac->states[state].first_child; child != NO_STATE;
+         child = ac->states[child].next_sibling) {
+        if (ac->states[child].label == byte) return child;
+    }
+    return NO_STATE;
+}
+
+static uint32_t addState(AhoCorasick* ac, uint32_t parent, uint8_t byte) {
+    if (ac->count == ac->capacity) {
+        uint32_t new_capacity = ac->capacity * 2;
+        AcState* grown = realloc(ac->states, new_capacity * sizeof(AcState));
+        if (!grown) return NO_STATE;
+        ac->states = grown;
+        ac->capacity = new_capacity;
+    }
+    uint32_t id = ac->count++;
+    AcState* state = &ac->states[id];
+    state->fail = AC_ROOT;
+    state->output = NO_STATE;
+    state->first_child = NO_STATE;
+    state->entry = NO_ENTRY;
+    state->label = byte;
+    state->depth = 0;
+    state->next_sibling = NO_STATE;
+    if (parent != NO_STATE) {
+        state->depth = ac->states[parent].depth + 1;
+        if (parent == AC_ROOT) {
+            ac->root_next[byte] = id;
+        } else {
+            state->next_sibling = ac->states[parent].first_child;
+            ac->states[parent].first_child = id;
+        }
+    }
+    return id;
+}
+
+// Sets the failure and output links breadth first, so shallower states are done first
+static int linkStates(AhoCorasick* ac) {
+    uint32_t* queue = malloc(ac->count * sizeof(uint32_t));
+    if (!queue) return 0;
+
+    uint32_t head = 0, tail = 0;
+    for (int byte = 0; byte < 256; byte++) {
+        if (ac->root_next[byte] != NO_STATE) queue[tail++] = ac->root_next[byte];
+    }
+    while (head < tail) {
+        uint32_t parent = queue[head++];
+        for (uint32_t child = ac->states[parent].first_child; child != NO_STATE;
+             child = ac->states[child].next_sibling) {
+            uint8_t byte = ac->states[child].label;
+            queue[tail++] = child;
+
+            uint32_t fail = ac->states[parent].fail;
+            uint32_t next = findChild(ac, fail, byte);
+            while (next == NO_STATE && fail != AC_ROOT) {
+                fail = ac->states[fail].fail;
+                next = findChild(ac, fail, byte);
+            }
+            AcState* state = &ac->states[child];
+            state->fail = (next == NO_STATE) ? AC_ROOT : next;
+            const AcState* suffix = &ac->states[state->fail];
+            state->output = (suffix->entry != NO_ENTRY) ? state->fail : suffix->output;
+        }
+    }
+    free(queue);
+    return 1;
+}
+
+AhoCorasick* aho_corasick_build(const BinarySequence* entries, uint16_t count) {
+    AhoCorasick* ac = calloc(1, sizeof(AhoCorasick));
+    if (!ac) return NULL;
+    ac->capacity = 1024;
+    ac->states = malloc(ac->capacity * sizeof(AcState));
+    if (!ac->states) {
+        free(ac);
+        return NULL;
+    }
+    for (int byte = 0; byte < 256; byte++) {
+        ac->root_next[byte] = NO_STATE;
+    }
+    addState(ac, NO_STATE, 0);
+
+    for (uint16_t i = 0; i < count; i++) {
+        const BinarySequence* entry = &entries[i];
+        if (entry->length <= 0 || entry->length > SEQ_LENGTH_LIMIT) continue;
+
+        uint32_t state = AC_ROOT;
+        for (int j = 0; j < entry->length; j++) {
+            uint32_t next = findChild(ac, state, entry->sequence[j]);
+            if (next == NO_STATE) next = addState(ac, state, entry->sequence[j]);
+            if (next == NO_STATE) {
+                fprintf(stderr, "Error: Unable to grow the matcher\n");
+                aho_corasick_free(ac);
+                return NULL;
+            }
+            state = next;
+        }
+        ac->states[state].entry = i;
+    }
+
+    if (!linkStates(ac)) {
+        aho_corasick_free(ac);
+        return NULL;
+    }
+
+    // Bytes that start no entry stay at the root
+    for (int byte = 0; byte < 256; byte++) {
+        if (ac->root_next[byte] == NO_STATE) ac->root_next[byte] = AC_ROOT;
+    }
+    return ac;
+}
+
+void aho_corasick_free(AhoCorasick* ac) {
+    if (!ac) return;
+    free(ac->states);
+    free(ac);
+}
+
+uint32_t aho_corasick_step(const AhoCorasick* ac, uint32_t state, uint8_t byte) {
+    uint32_t next = findChild(ac, state, byte);
+    while (next == NO_STATE) {
+        state = ac->states[state].fail;
+        next = findChild(ac, state, byte);
+    }
+    return next;
+}
+
+int aho_corasick_matches(const AhoCorasick* ac, uint32_t state, AcMatch* out) {
+    int count = 0;
+    if (ac->states[state].entry == NO_ENTRY) state = ac->states[state].output;
+    while (state != NO_STATE && count < SEQ_LENGTH_LIMIT) {
+        out[count].entry = (uint16_t)ac->states[state].entry;
+        out[count].length = ac->states[state].depth;
+        count++;
+        state = ac->states[state].output;
+    }
+    return count;
+}
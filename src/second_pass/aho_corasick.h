@@ -0,0 +1,38 @@
+// aho_corasick.h
+#ifndef AHO_CORASICK_H
+#define AHO_CORASICK_H
+
+#include <stdint.h>
+#include "../common_types.h"
+#include "../constants.h"
+
+#define AC_ROOT 0
+
+// Opaque pointer to hide implementation details
+typedef struct AhoCorasick AhoCorasick;
+
+// A dictionary entry ending at the current position
+typedef struct {
+    uint16_t entry;   // Index of the entry
+    uint8_t length;   // Length of the entry
+} AcMatch;
+
+/**
+ * Compiles the entries into an Aho-Corasick automaton with failure and output links.
+ * @param entries Sequences to match, each at most SEQ_LENGTH_LIMIT long
+ * @param count Number of entries
+ * @return The automaton, or NULL on allocation failure
+ */
+AhoCorasick* aho_corasick_build(const BinarySequence* entries, uint16_t count);
+void aho_corasick_free(AhoCorasick* automaton);
+
+// State after reading byte in state; start every block at AC_ROOT.
+uint32_t aho_corasick_step(const AhoCorasick* automaton, uint32_t state, uint8_t byte);
+
+/**
+ * Lists the entries ending at the position whose state is state, longest first.
+ * @return Number of matches written to out (at most SEQ_LENGTH_LIMIT)
+ */
+int aho_corasick_matches(const AhoCorasick* automaton, uint32_t state, AcMatch* out);
+
+#endif
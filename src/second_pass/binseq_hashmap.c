@@ -3,89 +3,353 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
-#include "xxhash.h"
-#include "tree_node.h"
+#include "../constants.h"
+#include "../xxhash.h"
+#include "bloom_filter.h"
+#include "seq_compare.h"
+#include "select.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#define ARENA_MIN_BYTES 4096
+#define MIGRATE_SLOTS 32   // Old slots an insert moves during an incremental resize
+#define EVICT_SHARE 4      // A capped map that is full evicts 1/EVICT_SHARE of its entries
+#define BATCH_WIDTH 32   // Keys of a batch whose lines are in flight together
+
+/**
+ * Table layout: power-of-two slots, and next to them one control byte per slot,
+ * CTRL_EMPTY or the low 7 bits of the slot's hash. A probe matches the 7 bits
+ * against a group of GROUP_WIDTH control bytes at once and only looks at the
+ * entries whose bits match; a group with an empty slot ends the probe. The control
+ * array repeats its first group after the end, so a group can start at any slot.
+ */
+#define GROUP_WIDTH 16
+#define CTRL_EMPTY 0x80
+#define MIN_CAPACITY GROUP_WIDTH
 
 // Internal structures
 typedef struct {
-    uint8_t* binary_sequence;  // Key part
+    uint64_t hash;             // hash_sequence() of the key
+    uint32_t key_offset;       // Key part, in the key arena
     uint16_t length;           // Key part
-    int frequency;             // Value part
-    int used;
+    SequenceRecord value;      // Value part
 } Entry;
 
+// Keys of all entries back to back; only grows, and goes away with the map
+typedef struct {
+    uint8_t* bytes;
+    size_t size;
+    size_t capacity;
+} KeyArena;
+
+// Optional prefilter; lookups count through it, hence outside the (const) map
+typedef struct {
+    BloomFilter* bloom;
+    BinSeqMapFilterStats stats;
+} MapFilter;
+
 struct BinSeqMap {
     Entry* entries;
-    size_t capacity;
+    uint8_t* ctrl;             // capacity + GROUP_WIDTH control bytes
+    size_t capacity;           // Power of two
     size_t size;
+    KeyArena keys;
+    MapFilter* filter;
+    BinSeqMapStats* counters;  // Lookup and resize counters, when enabled
+    bool incremental;          // Resize a little on every insert rather than all at once
+    // Table being emptied into the one above by an incremental resize. Its slots
+    // from moved on still hold their entries; old_capacity is 0 when there is none.
+    Entry* old_entries;
+    uint8_t* old_ctrl;
+    size_t old_capacity;
+    size_t moved;
+    size_t max_entries;        // 0 when the map is not capped
+    BinSeqMapEvictionStats evictions;
 };
 
+static inline const uint8_t* entry_key(const BinSeqMap* map, const Entry* entry) {
+    return map->keys.bytes + entry->key_offset;
+}
+
+/**
+ * Copies a key to the end of the arena.
+ * @return 1 and the key's offset in *offset, or 0 if the arena cannot grow
+ */
+static int arena_append(KeyArena* arena, const uint8_t* key, uint16_t length, uint32_t* offset) {
+    if (arena->size + length > arena->capacity) {
+        size_t new_capacity = arena->capacity ? arena->capacity * 2 : ARENA_MIN_BYTES;
+        while (new_capacity < arena->size + length) new_capacity *= 2;
+        if (new_capacity - 1 > UINT32_MAX) {
+            fprintf(stderr, "\n Key arena of map is full \n");
+            return 0;
+        }
+        uint8_t* grown = realloc(arena->bytes, new_capacity);
+        if (!grown) return 0;
+        arena->bytes = grown;
+        arena->capacity = new_capacity;
+    }
+    memcpy(arena->bytes + arena->size, key, length);
+    *offset = (uint32_t)arena->size;
+    arena->size += length;
+    return 1;
+}
+
+static inline uint8_t fingerprint(uint64_t hash) {
+    return (uint8_t)(hash & 0x7F);
+}
+
+// First slot of the probe; the fingerprint bits are left out
+static inline size_t home_slot(uint64_t hash, size_t capacity) {
+    return (size_t)(hash >> 7) & (capacity - 1);
+}
+
+// Bit i set when control byte i of the group equals value
+static inline uint32_t group_match(const uint8_t* group, uint8_t value) {
+#ifdef __SSE2__
+    __m128i ctrl = _mm_loadu_si128((const __m128i*)group);
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(ctrl, _mm_set1_epi8((char)value)));
+#else
+    uint32_t mask = 0;
+    for (int i = 0; i < GROUP_WIDTH; i++) {
+        mask |= (uint32_t)(group[i] == value) << i;
+    }
+    return mask;
+#endif
+}
+
+static inline void set_ctrl(BinSeqMap* map, size_t slot, uint8_t value) {
+    map->ctrl[slot] = value;
+    if (slot < GROUP_WIDTH) map->ctrl[map->capacity + slot] = value;
+}
+
+/**
+ * Allocates an empty table of capacity slots.
+ * @return 1 on success, 0 on allocation failure (the map is left untouched)
+ */
+static int alloc_table(BinSeqMap* map, size_t capacity) {
+    Entry* entries = malloc(capacity * sizeof(Entry));
+    uint8_t* ctrl = malloc(capacity + GROUP_WIDTH);
+    if (!entries || !ctrl) {
+        free(entries);
+        free(ctrl);
+        return 0;
+    }
+    memset(ctrl, CTRL_EMPTY, capacity + GROUP_WIDTH);
+    map->entries = entries;
+    map->ctrl = ctrl;
+    map->capacity = capacity;
+    return 1;
+}
+
+// Empty slot on the probe sequence of hash; the table always has one
+static size_t find_empty_slot(const BinSeqMap* map, uint64_t hash) {
+    size_t mask = map->capacity - 1;
+    size_t pos = home_slot(hash, map->capacity);
+    for (size_t step = GROUP_WIDTH;; step += GROUP_WIDTH) {
+        uint32_t empty = group_match(map->ctrl + pos, CTRL_EMPTY);
+        if (empty) return (pos + (size_t)__builtin_ctz(empty)) & mask;
+        pos = (pos + step) & mask;
+    }
+}
+
+// Bytes of a short key as an integer, byte i in bits 8i..8i+7
+static inline uint64_t pack_short_key(const uint8_t* key, uint16_t length) {
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    // Two overlapping words; the bytes they share are the same, so OR keeps them
+    if (length >= 4) return seq_load32(key) | (uint64_t)seq_load32(key + length - 4) << ((length - 4) * 8);
+    if (length >= 2) return seq_load16(key) | (uint64_t)seq_load16(key + length - 2) << ((length - 2) * 8);
+    return key[0];
+#else
+    uint64_t packed = 0;
+    for (uint16_t i = 0; i < length; i++) packed |= (uint64_t)key[i] << (i * 8);
+    return packed;
+#endif
+}
+
+/**
+ * Multiply-xorshift of a packed short key. Every step is invertible, so for a
+ * given length distinct keys get distinct hashes: equal hash and length is key
+ * equality, and short keys are never compared byte by byte.
+ */
+static inline uint64_t hash_short_key(uint64_t packed, uint16_t length) {
+    uint64_t h = (packed ^ length) * 0x9E3779B97F4A7C15ULL;
+    h ^= h >> 32;
+    h *= 0xD6E8FEB86659FD93ULL;
+    h ^= h >> 32;
+    return h;
+}
+
 // Helper functions
 static uint64_t hash_sequence(const uint8_t* sequence, uint16_t length) {
     if (!sequence || length == 0) return 0;
+    if (length <= BINSEQ_MAP_SHORT_KEY) return hash_short_key(pack_short_key(sequence, length), length);
     return XXH3_64bits(sequence, length);
 }
 
-static int sequences_equal(const uint8_t* a, uint16_t a_len, 
-                         const uint8_t* b, uint16_t b_len) {
-    if (a_len != b_len) return 0;
-    return memcmp(a, b, a_len) == 0;
+// Work of a probe, for the stats
+typedef struct {
+    size_t groups;
+    size_t compares;
+} ProbeCost;
+
+/**
+ * Probes group after group, each GROUP_WIDTH further than the last step (the
+ * triangular sequence visits every group of a power-of-two table). Entries are
+ * read only where the fingerprint matches.
+ */
+static Entry* probe_slots(const BinSeqMap* map, Entry* entries, const uint8_t* ctrl, size_t capacity,
+                          const uint8_t* sequence, uint16_t length, uint64_t hash, ProbeCost* cost) {
+    size_t mask = capacity - 1;
+    size_t pos = home_slot(hash, capacity);
+    uint8_t bits = fingerprint(hash);
+    for (size_t step = GROUP_WIDTH; step <= capacity + GROUP_WIDTH; step += GROUP_WIDTH) {
+        const uint8_t* group = ctrl + pos;
+        cost->groups++;
+        for (uint32_t match = group_match(group, bits); match; match &= match - 1) {
+            Entry* entry = &entries[(pos + (size_t)__builtin_ctz(match)) & mask];
+            cost->compares++;
+            if (entry->hash == hash && entry->length == length &&
+                (length <= BINSEQ_MAP_SHORT_KEY || seq_equal(entry_key(map, entry), sequence, length))) {
+                return entry;
+            }
+        }
+        if (group_match(group, CTRL_EMPTY)) break;
+        pos = (pos + step) & mask;
+    }
+    return NULL;
+}
+
+/**
+ * Probes the table, then the old one while a resize is in progress. A key found in
+ * the old table is one not moved yet: moved keys are found in the table first.
+ */
+static Entry* probe_table(const BinSeqMap* map,
+                          const uint8_t* sequence, uint16_t length, uint64_t hash) {
+    ProbeCost cost = {0, 0};
+    Entry* entry = probe_slots(map, map->entries, map->ctrl, map->capacity, sequence, length, hash, &cost);
+    if (!entry && map->old_capacity) {
+        entry = probe_slots(map, map->old_entries, map->old_ctrl, map->old_capacity,
+                            sequence, length, hash, &cost);
+    }
+
+    BinSeqMapStats* counters = map->counters;
+    if (counters) {
+        counters->lookups++;
+        counters->hits += entry != NULL;
+        counters->misses += entry == NULL;
+        counters->key_compares += cost.compares;
+        counters->probe_groups[MIN(cost.groups, (size_t)BINSEQ_MAP_PROBE_BUCKETS) - 1]++;
+    }
+    return entry;
+}
+
+// True when the filter, if the map has one, rules the key out
+static inline bool filter_rejects(const BinSeqMap* map, uint64_t hash) {
+    MapFilter* filter = map->filter;
+    if (!filter) return false;
+    filter->stats.probes++;
+    if (bloom_filter_may_contain(filter->bloom, hash)) return false;
+    filter->stats.rejected++;
+    return true;
 }
 
+// Probe of a key the filter passed
+static inline Entry* probe_passed(const BinSeqMap* map,
+                                  const uint8_t* sequence, uint16_t length, uint64_t hash) {
+    Entry* entry = probe_table(map, sequence, length, hash);
+    if (!entry && map->filter) map->filter->stats.false_positives++;
+    return entry;
+}
+
+// Lookup through the filter, if the map has one
 static Entry* find_entry(const BinSeqMap* map, 
                         const uint8_t* sequence, uint16_t length) {
     if (!map || !sequence || length == 0) return NULL;
-    
     uint64_t hash = hash_sequence(sequence, length);
-    size_t index = hash % map->capacity;
-    
-    for (size_t i = 0; i < map->capacity; i++) {
-        size_t try = (index + i) % map->capacity;
-        Entry* entry = &map->entries[try];
-        
-        if (!entry->used) return NULL;
-        if (sequences_equal(entry->binary_sequence, entry->length, 
-                           sequence, length)) {
-            return entry;
-        }
+    if (filter_rejects(map, hash)) return NULL;
+    return probe_passed(map, sequence, length, hash);
+}
+
+/**
+ * Moves up to count slots of the old table into the table, and frees the old
+ * table once all of its slots have been moved.
+ */
+static void migrate_slots(BinSeqMap* map, size_t count) {
+    size_t end = map->old_capacity - map->moved > count ? map->moved + count : map->old_capacity;
+    for (; map->moved < end; map->moved++) {
+        if (map->old_ctrl[map->moved] == CTRL_EMPTY) continue;
+        const Entry* entry = &map->old_entries[map->moved];
+        size_t slot = find_empty_slot(map, entry->hash);
+        map->entries[slot] = *entry;
+        set_ctrl(map, slot, map->old_ctrl[map->moved]);
+    }
+    if (map->moved == map->old_capacity) {
+        free(map->old_entries);
+        free(map->old_ctrl);
+        map->old_entries = NULL;
+        map->old_ctrl = NULL;
+        map->old_capacity = 0;
+        map->moved = 0;
+    }
+}
+
+/**
+ * Entry at or after *slot, counting the slots of the table and then those of the
+ * old table, if any. Sets *slot past the entry.
+ * @return The entry, or NULL past the last one
+ */
+static const Entry* next_entry(const BinSeqMap* map, size_t* slot) {
+    while (*slot < map->capacity) {
+        size_t i = (*slot)++;
+        if (map->ctrl[i] != CTRL_EMPTY) return &map->entries[i];
+    }
+    // Old slots before moved have their entries in the table already
+    if (*slot < map->capacity + map->moved) *slot = map->capacity + map->moved;
+    while (*slot < map->capacity + map->old_capacity) {
+        size_t i = (*slot)++ - map->capacity;
+        if (map->old_ctrl[i] != CTRL_EMPTY) return &map->old_entries[i];
     }
-    
     return NULL;
 }
 
 static int resize_map(BinSeqMap* map, size_t new_capacity) {
     if (!map || new_capacity <= map->size) return 0;
+    if (map->old_capacity) migrate_slots(map, map->old_capacity);
+    if (map->counters) map->counters->resizes++;
     
-    Entry* new_entries = calloc(new_capacity, sizeof(Entry));
-    if (!new_entries) return 0;
+    Entry* old_entries = map->entries;
+    uint8_t* old_ctrl = map->ctrl;
+    size_t old_capacity = map->capacity;
+    if (!alloc_table(map, new_capacity)) return 0;
+
+    // Inserts move the entries from here on; lookups look in both tables meanwhile
+    if (map->incremental) {
+        map->old_entries = old_entries;
+        map->old_ctrl = old_ctrl;
+        map->old_capacity = old_capacity;
+        map->moved = 0;
+        return 1;
+    }
     
     // Rehash all entries
-    for (size_t i = 0; i < map->capacity; i++) {
-        Entry* old = &map->entries[i];
-        if (!old->used) continue;
-        
-        uint64_t hash = hash_sequence(old->binary_sequence, old->length);
-        size_t index = hash % new_capacity;
-        
-        // Find empty slot
-        for (size_t try = 0; try < new_capacity; try++) {
-            size_t pos = (index + try) % new_capacity;
-            if (!new_entries[pos].used) {
-                new_entries[pos] = *old;
-                break;
-            }
-        }
+    for (size_t i = 0; i < old_capacity; i++) {
+        if (old_ctrl[i] == CTRL_EMPTY) continue;
+        size_t slot = find_empty_slot(map, old_entries[i].hash);
+        map->entries[slot] = old_entries[i];
+        set_ctrl(map, slot, old_ctrl[i]);
     }
     
-    free(map->entries);
-    map->entries = new_entries;
-    map->capacity = new_capacity;
+    free(old_entries);
+    free(old_ctrl);
     return 1;
 }
 
 // Public interface implementation
 BinSeqMap* binseq_map_create(size_t initial_capacity) {
-    if (initial_capacity == 0) initial_capacity = 16;
+    size_t capacity = MIN_CAPACITY;
+    while (capacity < initial_capacity) capacity *= 2;
     
     BinSeqMap* map = calloc(1, sizeof(BinSeqMap));
     if (!map) {
@@ -93,78 +357,100 @@ BinSeqMap* binseq_map_create(size_t initial_capacity) {
         return NULL;
     }
     
-    map->entries = calloc(initial_capacity, sizeof(Entry));
-    if (!map->entries) {
+    if (!alloc_table(map, capacity)) {
         free(map);
         return NULL;
     }
     
-    map->capacity = initial_capacity;
     map->size = 0;
     return map;
 }
 
+void binseq_map_set_incremental_resize(BinSeqMap* map, bool enabled) {
+    if (!map) return;
+    map->incremental = enabled;
+    if (!enabled && map->old_capacity) migrate_slots(map, map->old_capacity);
+}
+
 void binseq_map_free(BinSeqMap* map) {
     if (!map) return;
     
-    if (map->entries) {
-        for (size_t i = 0; i < map->capacity; i++) {
-            Entry* entry = &map->entries[i];
-            if (entry->used) {
-                free(entry->binary_sequence);
-                // Clear the entry
-                memset(entry, 0, sizeof(Entry));
-            }
-        }
-        free(map->entries);
-        map->entries = NULL;
+    free(map->entries);
+    free(map->ctrl);
+    free(map->keys.bytes);
+    free(map->old_entries);
+    free(map->old_ctrl);
+    free(map->counters);
+    if (map->filter) {
+        bloom_filter_free(map->filter->bloom);
+        free(map->filter);
     }
     
     free(map);
 }
 
-int binseq_map_put(BinSeqMap* map, 
-                  const uint8_t* key_sequence, uint16_t key_length,
-                  int value_frequency) {
-    if (!map || !key_sequence || key_length == 0) return 0;
-    
-    // Check if resize needed (70% load factor)
-    if (map->size * 10 > map->capacity * 7) {
-        if (!resize_map(map, map->capacity * 2)) return 0;
+static int evict_entries(BinSeqMap* map);
+
+/**
+ * Finds the entry of the key, adding it with a zeroed value when missing.
+ * @return The entry, or NULL on allocation failure
+ */
+static Entry* find_or_add_entry(BinSeqMap* map, const uint8_t* key_sequence, uint16_t key_length) {
+    // Check if key exists; writes bypass the filter and its counters
+    uint64_t hash = hash_sequence(key_sequence, key_length);
+    Entry* existing = probe_table(map, key_sequence, key_length, hash);
+    if (existing) {
+        return existing;
     }
+    if (map->old_capacity) migrate_slots(map, MIGRATE_SLOTS);
+    if (map->max_entries && map->size >= map->max_entries && !evict_entries(map)) return NULL;
     
-    // Check if key exists
-    Entry* existing = find_entry(map, key_sequence, key_length);
-    if (existing) {
-        // Update existing entry
-        existing->frequency = value_frequency;
-        return 1;
+    // Check if resize needed (7/8 load factor, which keeps an empty slot in every probe)
+    if ((map->size + 1) * 8 > map->capacity * 7) {
+        if (!resize_map(map, map->capacity * 2)) return NULL;
     }
     
     // Create new entry
-    uint64_t hash = hash_sequence(key_sequence, key_length);
-    size_t index = hash % map->capacity;
-    
-    for (size_t i = 0; i < map->capacity; i++) {
-        size_t try = (index + i) % map->capacity;
-        Entry* entry = &map->entries[try];
-        
-        if (!entry->used) {
-            // Copy key
-            entry->binary_sequence = malloc(key_length);
-            if (!entry->binary_sequence) return 0;
-            memcpy(entry->binary_sequence, key_sequence, key_length);
-            entry->length = key_length;
-            
-            // Set value
-            entry->frequency = value_frequency;
-            entry->used = 1;
-            map->size++;
-            return 1;
-        }
-    }
+    size_t slot = find_empty_slot(map, hash);
+    Entry* entry = &map->entries[slot];
     
-    return 0;
+    // Copy key
+    if (!arena_append(&map->keys, key_sequence, key_length, &entry->key_offset)) return NULL;
+    entry->length = key_length;
+    entry->hash = hash;
+    memset(&entry->value, 0, sizeof(entry->value));
+    set_ctrl(map, slot, fingerprint(hash));
+    map->size++;
+    if (map->filter) bloom_filter_add(map->filter->bloom, hash);
+    return entry;
+}
+
+int binseq_map_put(BinSeqMap* map, 
+                  const uint8_t* key_sequence, uint16_t key_length,
+                  int value_frequency) {
+    if (!map || !key_sequence || key_length == 0) return 0;
+
+    Entry* entry = find_or_add_entry(map, key_sequence, key_length);
+    if (!entry) return 0;
+    entry->value.frequency = value_frequency;
+    return 1;
+}
+
+int binseq_map_put_record(BinSeqMap* map,
+                          const uint8_t* key_sequence, uint16_t key_length,
+                          const SequenceRecord* record) {
+    if (!map || !key_sequence || key_length == 0 || !record) return 0;
+
+    Entry* entry = find_or_add_entry(map, key_sequence, key_length);
+    if (!entry) return 0;
+    entry->value = *record;
+    return 1;
+}
+
+const SequenceRecord* binseq_map_get_record(const BinSeqMap* map,
+                                            const uint8_t* key_sequence, uint16_t key_length) {
+    Entry* entry = find_entry(map, key_sequence, key_length);
+    return entry ? &entry->value : NULL;
 }
 
 const int* binseq_map_get_frequency(const BinSeqMap* map, 
@@ -178,7 +464,142 @@ const int* binseq_map_get_frequency(const BinSeqMap* map,
         return NULL;
     }
 
-    return &entry->frequency;
+    return &entry->value.frequency;
+}
+
+size_t binseq_map_get_batch(const BinSeqMap* map, const uint8_t* const* keys, const uint16_t* lens,
+                            const SequenceRecord** out, size_t n) {
+    if (!map || !keys || !lens || !out) return 0;
+
+    size_t found = 0;
+    uint64_t batch_hashes[BATCH_WIDTH];
+    uint8_t passed[BATCH_WIDTH];
+    for (size_t first = 0; first < n; first += BATCH_WIDTH) {
+        size_t count = MIN((size_t)BATCH_WIDTH, n - first);
+        const uint64_t* hash = batch_hashes;
+        for (size_t i = 0; i < count; i++) {
+            batch_hashes[i] = hash_sequence(keys[first + i], lens[first + i]);
+        }
+
+        // Filter blocks first; only keys the filter passes go on to the table
+        if (map->filter) {
+            for (size_t i = 0; i < count; i++) bloom_filter_prefetch(map->filter->bloom, hash[i]);
+        }
+        size_t pass_count = 0;
+        for (size_t i = 0; i < count; i++) {
+            out[first + i] = NULL;
+            if (!keys[first + i] || lens[first + i] == 0 || filter_rejects(map, hash[i])) continue;
+            size_t home = home_slot(hash[i], map->capacity);
+            __builtin_prefetch(map->ctrl + home);
+            __builtin_prefetch(&map->entries[home]);
+            passed[pass_count++] = (uint8_t)i;
+        }
+
+        for (size_t p = 0; p < pass_count; p++) {
+            size_t i = passed[p];
+            Entry* entry = probe_passed(map, keys[first + i], lens[first + i], hash[i]);
+            out[first + i] = entry ? &entry->value : NULL;
+            found += entry != NULL;
+        }
+    }
+    return found;
+}
+
+int binseq_map_build_filter(BinSeqMap* map, unsigned bits_per_key) {
+    if (!map) return 0;
+
+    MapFilter* filter = calloc(1, sizeof(MapFilter));
+    BloomFilter* bloom = bloom_filter_create(map->size, bits_per_key);
+    if (!filter || !bloom) {
+        free(filter);
+        bloom_filter_free(bloom);
+        return 0;
+    }
+    size_t slot = 0;
+    for (const Entry* entry; (entry = next_entry(map, &slot));) {
+        bloom_filter_add(bloom, entry->hash);
+    }
+
+    if (map->filter) {
+        bloom_filter_free(map->filter->bloom);
+        free(map->filter);
+    }
+    filter->bloom = bloom;
+    filter->stats.filter_bytes = bloom_filter_bytes(bloom);
+    map->filter = filter;
+    return 1;
+}
+
+int binseq_map_filter_stats(const BinSeqMap* map, BinSeqMapFilterStats* stats) {
+    if (!map || !map->filter || !stats) return 0;
+    *stats = map->filter->stats;
+    return 1;
+}
+
+void binseq_map_print_filter_stats(const BinSeqMap* map, const char* name) {
+    BinSeqMapFilterStats stats;
+    if (!binseq_map_filter_stats(map, &stats)) return;
+
+    size_t misses = stats.rejected + stats.false_positives;
+    printf("Bloom filter (%s): %zu bytes for %zu keys, %zu probes, %zu rejected, "
+           "%zu false positives (%.3f%% of misses)\n",
+           name, stats.filter_bytes, binseq_map_size(map), stats.probes, stats.rejected,
+           stats.false_positives, misses ? 100.0 * stats.false_positives / misses : 0.0);
+}
+
+int binseq_map_enable_stats(BinSeqMap* map) {
+    if (!map) return 0;
+    BinSeqMapStats* counters = calloc(1, sizeof(BinSeqMapStats));
+    if (!counters) return 0;
+    free(map->counters);
+    map->counters = counters;
+    return 1;
+}
+
+// Longest run of occupied slots, following the probe order around the end of the table
+static size_t longest_cluster(const BinSeqMap* map) {
+    size_t first_empty = 0;
+    while (first_empty < map->capacity && map->ctrl[first_empty] != CTRL_EMPTY) first_empty++;
+    if (first_empty == map->capacity) return map->capacity;
+
+    size_t longest = 0;
+    size_t run = 0;
+    for (size_t i = 1; i <= map->capacity; i++) {
+        size_t slot = (first_empty + i) & (map->capacity - 1);
+        run = map->ctrl[slot] == CTRL_EMPTY ? 0 : run + 1;
+        longest = MAX(longest, run);
+    }
+    return longest;
+}
+
+int binseq_map_stats(const BinSeqMap* map, BinSeqMapStats* stats) {
+    if (!map || !map->counters || !stats) return 0;
+    *stats = *map->counters;
+    stats->size = map->size;
+    stats->capacity = map->capacity;
+    stats->bytes = sizeof(BinSeqMap) + map->capacity * sizeof(Entry) + map->capacity + GROUP_WIDTH +
+                   map->keys.capacity;
+    if (map->old_capacity) {
+        stats->bytes += map->old_capacity * sizeof(Entry) + map->old_capacity + GROUP_WIDTH;
+    }
+    if (map->filter) stats->bytes += bloom_filter_bytes(map->filter->bloom);
+    stats->max_cluster = longest_cluster(map);
+    return 1;
+}
+
+void binseq_map_print_stats(const BinSeqMap* map, const char* name) {
+    BinSeqMapStats stats;
+    if (!binseq_map_stats(map, &stats)) return;
+
+    printf("Map (%s): %zu lookups, %zu hits, %zu misses, %.2f key compares each, groups read",
+           name, stats.lookups, stats.hits, stats.misses,
+           stats.lookups ? (double)stats.key_compares / stats.lookups : 0.0);
+    for (int i = 0; i < BINSEQ_MAP_PROBE_BUCKETS; i++) {
+        printf(" %s%d:%zu", i == BINSEQ_MAP_PROBE_BUCKETS - 1 ? ">=" : "", i + 1, stats.probe_groups[i]);
+    }
+    printf("\n  %zu of %zu slots used (%.1f%%), longest cluster %zu, %zu resizes, %zu bytes\n",
+           stats.size, stats.capacity, stats.capacity ? 100.0 * stats.size / stats.capacity : 0.0,
+           stats.max_cluster, stats.resizes, stats.bytes);
 }
 
 int binseq_map_increment_frequency(BinSeqMap* map, 
@@ -188,7 +609,7 @@ int binseq_map_increment_frequency(BinSeqMap* map,
         return 0; //entry does not exist
     }
     
-    entry->frequency++;
+    entry->value.frequency++;
     return 1;
 }
 
@@ -207,57 +628,170 @@ void binseq_map_print(const BinSeqMap* map) {
     }
     
     printf("\nMap (size=%zu, capacity=%zu): ", map->size, map->capacity);
-    for (size_t i = 0; i < map->capacity; i++) {
-        const Entry* entry = &map->entries[i];
-        if (!entry->used) continue;
-        
-        printf("\n ([%zu] Key (len=%u): ", i, entry->length);
+    size_t slot = 0;
+    for (const Entry* entry; (entry = next_entry(map, &slot));) {
+        printf("\n ([%zu] Key (len=%u): ", slot - 1, entry->length);
         uint16_t j;
         for (j = 0; j < entry->length; j++) {
-            printf("0x%02X ", entry->binary_sequence[j]);
+            printf("0x%02X ", entry_key(map, entry)[j]);
         }
-        printf("\t Freq: %d), ", entry->frequency);
+        printf("\t Freq: %d), ", entry->value.frequency);
         if (j%7 == 0) printf("\n");
     }
 }
 
-int binseq_map_copy_to_node(const BinSeqMap* source, struct TreeNode* target) {
-    if (!target) {
-        fprintf(stderr, "Invalid target node\n");
-        return 0;
-    }
 
-    // If source is NULL, just set target's map to NULL
-    if (!source) {
-        if (target->map) {
-            binseq_map_free(target->map);
-        }
-        target->map = NULL;
-        return 1;
+static inline void entry_item(const BinSeqMap* map, const Entry* entry, BinSeqMapItem* item) {
+    item->key_sequence = entry_key(map, entry);
+    item->key_length = entry->length;
+    item->frequency = entry->value.frequency;
+}
+
+size_t binseq_map_collect(const BinSeqMap* map, BinSeqMapItem* out, size_t max_items) {
+    if (!map || !out) return 0;
+
+    size_t count = 0;
+    BinSeqMapIterator it;
+    binseq_map_iter_init(&it, map);
+    while (count < max_items && binseq_map_iter_next(&it, &out[count])) {
+        count++;
     }
+    return count;
+}
+
+void binseq_map_iter_init(BinSeqMapIterator* it, const BinSeqMap* map) {
+    it->map = map;
+    it->slot = 0;
+}
+
+int binseq_map_iter_next(BinSeqMapIterator* it, BinSeqMapItem* item) {
+    const BinSeqMap* map = it->map;
+    if (!map) return 0;
+    const Entry* entry = next_entry(map, &it->slot);
+    if (!entry) return 0;
+    entry_item(map, entry, item);
+    return 1;
+}
+
+// Entry of the top-k selection
+typedef struct {
+    int64_t score;
+    const Entry* entry;
+    const uint8_t* key;
+} Scored;
+
+// Higher score first, then the longer key, then the smaller bytes
+static int compare_scored(const void* a, const void* b) {
+    const Scored* sa = a;
+    const Scored* sb = b;
+    if (sa->score != sb->score) return sa->score > sb->score ? -1 : 1;
+    uint16_t length = sa->entry->length;
+    if (length != sb->entry->length) return length > sb->entry->length ? -1 : 1;
+    uint16_t common = seq_common_prefix(sa->key, sb->key, length);
+    if (common == length) return 0;
+    return sa->key[common] < sb->key[common] ? -1 : 1;
+}
+
+size_t binseq_map_top_k(const BinSeqMap* map, size_t k, BinSeqMapScoreFn score, void* context,
+                        BinSeqMapItem* out) {
+    if (!map || !score || !out || k == 0) return 0;
 
-    BinSeqMap* new_map = binseq_map_create(source->capacity+1);
-    if (!new_map) {
-        fprintf(stderr, "Failed to create new map\n");
+    Scored* scored = malloc((map->size ? map->size : 1) * sizeof(Scored));
+    if (!scored) {
+        fprintf(stderr, "\n Unable to allocate top-k scores \n");
         return 0;
     }
+    size_t n = 0;
+    size_t slot = 0;
+    for (const Entry* entry; (entry = next_entry(map, &slot));) {
+        BinSeqMapItem item;
+        entry_item(map, entry, &item);
+        int64_t value = score(&item, context);
+        if (value == BINSEQ_MAP_SKIP) continue;
+        scored[n++] = (Scored){value, entry, item.key_sequence};
+    }
 
-    // Copy all entries
-    for (size_t i = 0; i < source->capacity; i++) {
-        const Entry* src = &source->entries[i];
-        if (!src->used) continue;
+    size_t count = MIN(k, n);
+    select_best(scored, n, sizeof(Scored), count, compare_scored);
+    qsort(scored, count, sizeof(Scored), compare_scored);
+    for (size_t i = 0; i < count; i++) {
+        entry_item(map, scored[i].entry, &out[i]);
+    }
+    free(scored);
+    return count;
+}
 
-        if (!binseq_map_put(new_map, src->binary_sequence, src->length, src->frequency)) {
-            fprintf(stderr, "Failed to put entry in new map\n");
-            binseq_map_free(new_map);
-            return 0;  // Return failure but new_map is already freed
-        }
+/**
+ * Keeps the entries with the highest length x frequency and drops the others,
+ * rebuilding the table and the key arena around the kept ones so that the bytes
+ * of evicted keys are released too, and refilling a filter from the kept keys
+ * alone. Ties go as in binseq_map_top_k.
+ * @return 1 on success, 0 on allocation failure (the map is left untouched)
+ */
+static int evict_entries(BinSeqMap* map) {
+    size_t n = map->size;
+    size_t drop = n / EVICT_SHARE ? n / EVICT_SHARE : 1;
+    size_t keep = n > drop ? n - drop : 0;
+
+    Scored* scored = malloc((n ? n : 1) * sizeof(Scored));
+    if (!scored) return 0;
+    size_t slot = 0;
+    size_t count = 0;
+    for (const Entry* entry; (entry = next_entry(map, &slot));) {
+        int64_t value = (int64_t)entry->length * entry->value.frequency;
+        scored[count++] = (Scored){value, entry, entry_key(map, entry)};
     }
+    select_best(scored, count, sizeof(Scored), keep, compare_scored);
 
-    // Free old map if it exists
-    if (target->map) {
-        binseq_map_free(target->map);
+    size_t key_bytes = 0;
+    for (size_t i = 0; i < keep; i++) key_bytes += scored[i].entry->length;
+    Entry* old_entries = map->entries;
+    uint8_t* old_ctrl = map->ctrl;
+    uint8_t* kept_keys = malloc(key_bytes ? key_bytes : 1);
+    if (!kept_keys || !alloc_table(map, map->capacity)) {
+        free(kept_keys);
+        free(scored);
+        return 0;
+    }
+
+    // The arena is sized for the kept keys, so appending cannot fail
+    KeyArena old_keys = map->keys;
+    map->keys = (KeyArena){kept_keys, 0, key_bytes ? key_bytes : 1};
+    if (map->filter) bloom_filter_clear(map->filter->bloom);
+    for (size_t i = 0; i < keep; i++) {
+        Entry entry = *scored[i].entry;
+        arena_append(&map->keys, scored[i].key, entry.length, &entry.key_offset);
+        size_t target = find_empty_slot(map, entry.hash);
+        map->entries[target] = entry;
+        set_ctrl(map, target, fingerprint(entry.hash));
+        if (map->filter) bloom_filter_add(map->filter->bloom, entry.hash);
     }
-    target->map = new_map;
+    for (size_t i = keep; i < count; i++) {
+        map->evictions.evicted_frequency += (uint64_t)scored[i].entry->value.frequency;
+    }
+    map->evictions.rounds++;
+    map->evictions.evicted += count - keep;
+    map->size = keep;
+
+    free(scored);
+    free(old_entries);
+    free(old_ctrl);
+    free(old_keys.bytes);
+    free(map->old_entries);
+    free(map->old_ctrl);
+    map->old_entries = NULL;
+    map->old_ctrl = NULL;
+    map->old_capacity = 0;
+    map->moved = 0;
     return 1;
-}
\ No newline at end of file
+}
+
+void binseq_map_set_limit(BinSeqMap* map, size_t max_entries) {
+    if (map) map->max_entries = max_entries;
+}
+
+int binseq_map_eviction_stats(const BinSeqMap* map, BinSeqMapEvictionStats* stats) {
+    if (!map || !map->max_entries || !stats) return 0;
+    *stats = map->evictions;
+    return 1;
+}
@@ -4,22 +4,134 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include "../common_types.h"
 
 // Opaque pointer to hide implementation details
 typedef struct BinSeqMap BinSeqMap;
 
+/**
+ * Keys up to this many bytes are packed into an integer, hashed with a cheap
+ * invertible multiply-xorshift and matched by hash and length alone. Longer keys
+ * use XXH3 and a byte compare.
+ */
+#define BINSEQ_MAP_SHORT_KEY 8
+
 // Create/destroy functions
 BinSeqMap* binseq_map_create(size_t initial_capacity);
 void binseq_map_free(BinSeqMap* map);
 
-// Map operations
+/**
+ * With incremental resize on, a full map allocates the larger table and leaves
+ * its entries where they are; every insert of a new key then moves a few of them
+ * over, and lookups search both tables until the last one has moved. No insert
+ * pays for rehashing the whole map. Turning it off finishes a resize in progress.
+ */
+void binseq_map_set_incremental_resize(BinSeqMap* map, bool enabled);
+
+/**
+ * Caps the map at max_entries keys, 0 lifting the cap. A new key arriving when the
+ * map is full first evicts the quarter of the entries with the lowest length x
+ * frequency, and the table, key arena and filter are rebuilt around the rest, so
+ * memory stays bounded by the cap. An evicted key seen again starts over from a
+ * zeroed record. Each round rebuilds the whole table: about 0.3 s for a full
+ * 2^21-slot map, or 0.7 us for each of the entries it makes room for.
+ */
+void binseq_map_set_limit(BinSeqMap* map, size_t max_entries);
+
+typedef struct {
+    size_t rounds;               // Times the map was full
+    size_t evicted;              // Entries evicted
+    uint64_t evicted_frequency;  // Sum of their frequencies
+} BinSeqMapEvictionStats;
+
+// Fills stats and returns 1, or returns 0 if the map is not capped
+int binseq_map_eviction_stats(const BinSeqMap* map, BinSeqMapEvictionStats* stats);
+
+/**
+ * Map operations. The value of a key is a SequenceRecord; the frequency functions
+ * read and write its frequency only, a new key starting from a zeroed record.
+ */
 int binseq_map_put(BinSeqMap* map, 
                   const uint8_t* key_sequence, uint16_t key_length,
                   int value_frequency);
 
+// Sets the whole record of the key, adding the key if needed
+int binseq_map_put_record(BinSeqMap* map,
+                          const uint8_t* key_sequence, uint16_t key_length,
+                          const SequenceRecord* record);
+
+// Returns the record of the key, or NULL if the key is not in the map
+const SequenceRecord* binseq_map_get_record(const BinSeqMap* map,
+                                            const uint8_t* key_sequence, uint16_t key_length);
+
 const int* binseq_map_get_frequency(const BinSeqMap* map, 
                                    const uint8_t* key_sequence, uint16_t key_length);
 
+/**
+ * Looks up n independent keys at once. All hashes are computed and the filter
+ * block, control group and first entry of every key are prefetched before the
+ * first key is resolved, so the cache misses of the keys overlap.
+ * @param out Receives the record of each key, or NULL when it is missing
+ * @return Number of keys found
+ */
+size_t binseq_map_get_batch(const BinSeqMap* map, const uint8_t* const* keys, const uint16_t* lens,
+                            const SequenceRecord** out, size_t n);
+
+/**
+ * Builds a Bloom filter over the keys in the map. Lookups then probe the table
+ * only when the filter passes; keys put afterwards are added to the filter too.
+ * Meant for maps that stop growing and mostly see misses, e.g. a dictionary after
+ * training; lookup-bench is its only user.
+ * @param bits_per_key Filter bits per key
+ * @return 1 on success, 0 on allocation failure (the map stays unfiltered)
+ */
+int binseq_map_build_filter(BinSeqMap* map, unsigned bits_per_key);
+
+typedef struct {
+    size_t filter_bytes;
+    size_t probes;           // Lookups that went through the filter
+    size_t rejected;         // ... answered by the filter alone
+    size_t false_positives;  // ... passed by the filter but missing from the table
+} BinSeqMapFilterStats;
+
+// Fills stats and returns 1, or returns 0 if the map has no filter
+int binseq_map_filter_stats(const BinSeqMap* map, BinSeqMapFilterStats* stats);
+
+// Prints the filter statistics of the map under name, if it has a filter
+void binseq_map_print_filter_stats(const BinSeqMap* map, const char* name);
+
+#define BINSEQ_MAP_PROBE_BUCKETS 8
+
+/**
+ * Counters of a map with stats enabled. A lookup is any probe of the table, those
+ * of inserts included; keys the filter rejects never reach the table.
+ */
+typedef struct {
+    size_t lookups;
+    size_t hits;
+    size_t misses;
+    size_t key_compares;     // Entries whose fingerprint matched, so that they were checked against the key
+    size_t probe_groups[BINSEQ_MAP_PROBE_BUCKETS];  // Lookups by control groups read, 1 and up;
+                                                    // the last bucket counts longer probes too
+    size_t resizes;
+    // State of the map when the stats are read
+    size_t size;
+    size_t capacity;
+    size_t bytes;            // Map, table, control bytes, key arena and filter
+    size_t max_cluster;      // Longest run of occupied slots
+} BinSeqMapStats;
+
+// Starts the counters of the map from zero; returns 1, or 0 on allocation failure
+int binseq_map_enable_stats(BinSeqMap* map);
+
+// Fills stats and returns 1, or returns 0 if stats are not enabled
+int binseq_map_stats(const BinSeqMap* map, BinSeqMapStats* stats);
+
+// Prints the counters of the map under name, if stats are enabled
+void binseq_map_print_stats(const BinSeqMap* map, const char* name);
+
 int binseq_map_increment_frequency(BinSeqMap* map, 
                                  const uint8_t* key_sequence, uint16_t key_length);
 
@@ -28,8 +140,41 @@ size_t binseq_map_size(const BinSeqMap* map);
 size_t binseq_map_capacity(const BinSeqMap* map);
 void binseq_map_print(const BinSeqMap* map);
 
-// Special copy function for TreeNode (implementation can see TreeNode definition)
-struct TreeNode;
-int binseq_map_copy_to_node(const BinSeqMap* source, struct TreeNode* target);
+// Snapshot of one entry. key_sequence points into the map and stays valid
+// until the map is modified or freed.
+typedef struct {
+    const uint8_t* key_sequence;
+    uint16_t key_length;
+    int frequency;
+} BinSeqMapItem;
+
+// Copies up to max_items entries into out (in table order) and returns the count
+size_t binseq_map_collect(const BinSeqMap* map, BinSeqMapItem* out, size_t max_items);
+
+// Walks the entries of a map in table order. Putting a new key invalidates it.
+typedef struct {
+    const BinSeqMap* map;
+    size_t slot;    // Next slot to look at
+} BinSeqMapIterator;
+
+void binseq_map_iter_init(BinSeqMapIterator* it, const BinSeqMap* map);
+
+// Fills item with the next entry and returns 1, or returns 0 past the last entry
+int binseq_map_iter_next(BinSeqMapIterator* it, BinSeqMapItem* item);
+
+// Score of an entry for binseq_map_top_k; BINSEQ_MAP_SKIP leaves the entry out
+#define BINSEQ_MAP_SKIP INT64_MIN
+typedef int64_t (*BinSeqMapScoreFn)(const BinSeqMapItem* item, void* context);
+
+/**
+ * Copies the k entries with the highest score into out, best first. Equal scores
+ * go to the longer key, then to the smaller bytes, so the result does not depend
+ * on table order. Selects over a compact copy of the scores in O(n + k log k)
+ * instead of sorting the whole table.
+ * @param context Passed to score
+ * @return Number of entries written, at most k
+ */
+size_t binseq_map_top_k(const BinSeqMap* map, size_t k, BinSeqMapScoreFn score, void* context,
+                        BinSeqMapItem* out);
 
 #endif
\ No newline at end of file
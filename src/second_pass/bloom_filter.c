@@ -0,0 +1,72 @@
+// bloom_filter.c
+#include "bloom_filter.h"
+#include <stdlib.h>
+#include <string.h>
+
+#define BLOOM_ALIGNMENT 64
+
+// Odd multipliers spreading the low hash half over the 8 words (as in Parquet's filter)
+static const uint32_t bloom_salts[BLOOM_WORDS_PER_BLOCK] = {
+    0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+    0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+};
+
+BloomFilter* bloom_filter_create(size_t key_count, unsigned bits_per_key) {
+    BloomFilter* filter = malloc(sizeof(BloomFilter));
+    if (!filter) return NULL;
+
+    size_t bits = key_count * bits_per_key;
+    size_t block_bits = BLOOM_WORDS_PER_BLOCK * 32;
+    size_t blocks = (bits + block_bits - 1) / block_bits;
+    filter->block_count = (uint32_t)(blocks ? blocks : 1);
+
+    size_t bytes = (size_t)filter->block_count * sizeof(*filter->blocks);
+    bytes = (bytes + BLOOM_ALIGNMENT - 1) / BLOOM_ALIGNMENT * BLOOM_ALIGNMENT;
+    filter->blocks = aligned_alloc(BLOOM_ALIGNMENT, bytes);
+    if (!filter->blocks) {
+        free(filter);
+        return NULL;
+    }
+    memset(filter->blocks, 0, bytes);
+    return filter;
+}
+
+void bloom_filter_free(BloomFilter* filter) {
+    if (!filter) return;
+    free(filter->blocks);
+    free(filter);
+}
+
+static inline uint32_t* blockOf(const BloomFilter* filter, uint64_t hash) {
+    uint64_t index = ((hash >> 32) * filter->block_count) >> 32;
+    return filter->blocks[index];
+}
+
+void bloom_filter_add(BloomFilter* filter, uint64_t hash) {
+    uint32_t* block = blockOf(filter, hash);
+    uint32_t key = (uint32_t)hash;
+    for (int w = 0; w < BLOOM_WORDS_PER_BLOCK; w++) {
+        block[w] |= 1U << ((key * bloom_salts[w]) >> 27);
+    }
+}
+
+void bloom_filter_clear(BloomFilter* filter) {
+    memset(filter->blocks, 0, (size_t)filter->block_count * sizeof(*filter->blocks));
+}
+
+bool bloom_filter_may_contain(const BloomFilter* filter, uint64_t hash) {
+    const uint32_t* block = blockOf(filter, hash);
+    uint32_t key = (uint32_t)hash;
+    for (int w = 0; w < BLOOM_WORDS_PER_BLOCK; w++) {
+        if (!(block[w] & (1U << ((key * bloom_salts[w]) >> 27)))) return false;
+    }
+    return true;
+}
+
+void bloom_filter_prefetch(const BloomFilter* filter, uint64_t hash) {
+    __builtin_prefetch(blockOf(filter, hash));
+}
+
+size_t bloom_filter_bytes(const BloomFilter* filter) {
+    return filter ? (size_t)filter->block_count * sizeof(*filter->blocks) : 0;
+}
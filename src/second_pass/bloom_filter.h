@@ -0,0 +1,41 @@
+// bloom_filter.h
+#ifndef BLOOM_FILTER_H
+#define BLOOM_FILTER_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define BLOOM_WORDS_PER_BLOCK 8  // 8 x 32 bits: a key only touches one 32-byte block
+
+/**
+ * Split block Bloom filter: the high half of a key's hash picks a block and the
+ * low half sets one bit in each of its words, so a lookup reads a single cache line.
+ */
+typedef struct {
+    uint32_t (*blocks)[BLOOM_WORDS_PER_BLOCK];
+    uint32_t block_count;
+} BloomFilter;
+
+/**
+ * @param key_count Keys the filter is sized for
+ * @param bits_per_key Filter bits per key; 16 keeps false positives well under 1%
+ * @return The empty filter, or NULL on allocation failure
+ */
+BloomFilter* bloom_filter_create(size_t key_count, unsigned bits_per_key);
+void bloom_filter_free(BloomFilter* filter);
+
+void bloom_filter_add(BloomFilter* filter, uint64_t hash);
+
+// Removes every key, keeping the size
+void bloom_filter_clear(BloomFilter* filter);
+
+// False means the key was never added; true means it probably was.
+bool bloom_filter_may_contain(const BloomFilter* filter, uint64_t hash);
+
+// Starts loading the block of the key, ahead of bloom_filter_may_contain
+void bloom_filter_prefetch(const BloomFilter* filter, uint64_t hash);
+
+size_t bloom_filter_bytes(const BloomFilter* filter);
+
+#endif
@@ -1,54 +1,121 @@
 #include "group.h"
 
+void groupLayoutDefault(GroupLayout* layout) {
+    layout->group_count = TOTAL_GROUPS;
+    layout->code_bits[0] = 4;  // 4-bit codeword
+    layout->code_bits[1] = 4;  // 4-bit codeword
+    layout->code_bits[2] = 4;  // 4-bit codeword
+    layout->code_bits[3] = 12; // 12-bit codeword
+}
+
+// Bits of the layout in the header: group count, then one width per group.
+uint16_t groupLayoutBits(const GroupLayout* layout) {
+    return GROUP_COUNT_BITS + layout->group_count * GROUP_WIDTH_BITS;
+}
+
 /*
- *    - 3-bit length
- *    - N bytes of sequence data
- *    - 2-bit group
- *    - groupCodeSize()
-*/
-uint8_t getHeaderOverhead(uint8_t group, uint16_t seq_length) {
-	if (group < TOTAL_GROUPS) {
-		return 3+(seq_length*8)+2+groupCodeSize(group);
-	} else {		
-        fprintf(stderr, "Invalid group %d Exiting!\n", group);
-        exit(0);
+ * Tries every non-decreasing set of widths for 1..TOTAL_GROUPS groups; with the
+ * entries ranked by uses, giving a group a wider code than a later one never helps.
+ * Each try only needs the use totals of its groups, read from the prefix sums.
+ */
+int groupLayoutOptimal(const uint32_t* uses, uint32_t entry_count, GroupLayout* layout) {
+    uint64_t *prefix = malloc((entry_count + 1) * sizeof(uint64_t));
+    if (!prefix) {
+        fprintf(stderr, "Error: Unable to allocate usage prefix sums\n");
         return 0;
     }
+    prefix[0] = 0;
+    for (uint32_t i = 0; i < entry_count; i++) {
+        prefix[i + 1] = prefix[i] + uses[i];
+    }
+
+    uint64_t best_cost = UINT64_MAX;
+    GroupLayout trial;
+    for (uint8_t groups = 1; groups <= TOTAL_GROUPS; groups++) {
+        trial.group_count = groups;
+        uint8_t selector_bits = groupSelectorBits(&trial);
+        uint8_t widths[TOTAL_GROUPS] = {0};
+
+        while (1) {
+            uint64_t cost = groupLayoutBits(&trial);
+            uint32_t start = 0;
+            for (uint8_t g = 0; g < groups && start < entry_count; g++) {
+                uint64_t end = start + (1u << widths[g]);
+                if (end > entry_count) end = entry_count;
+                cost += (prefix[end] - prefix[start]) * (uint64_t)(1 + selector_bits + widths[g]);
+                start = (uint32_t)end;
+            }
+            if (start >= entry_count && cost < best_cost) {
+                best_cost = cost;
+                memcpy(trial.code_bits, widths, sizeof(widths));
+                *layout = trial;
+            }
+
+            // Next non-decreasing width combination
+            int g = groups - 1;
+            while (g >= 0 && widths[g] == GROUP_MAX_CODE_BITS) g--;
+            if (g < 0) break;
+            widths[g]++;
+            for (int k = g + 1; k < groups; k++) widths[k] = widths[g];
+        }
+    }
+    free(prefix);
+    return best_cost != UINT64_MAX;
+}
+
+uint8_t getGroupOfRank(const GroupLayout* layout, uint32_t rank, uint16_t* codeword) {
+    uint32_t first = 0;
+    for (uint8_t g = 0; g < layout->group_count; g++) {
+        uint32_t end = getGroupThreshold(layout, g);
+        if (rank < end) {
+            *codeword = (uint16_t)(rank - first);
+            return g;
+        }
+        first = end;
+    }
+    return GROUP_UNASSIGNED;
+}
+
+// Bits a token spends on its group: none for a single group
+uint8_t groupSelectorBits(const GroupLayout* layout) {
+    uint8_t bits = 0;
+    while ((1u << bits) < layout->group_count) bits++;
+    return bits;
+}
+
+/*
+ *    - 6-bit length (stored as length-1, so 1..64 fits)
+ *    - N bytes of sequence data
+ * Group and codeword follow from the position of the entry in the header.
+*/
+uint16_t getHeaderOverhead(uint16_t seq_length) {
+    return HEADER_LENGTH_BITS + (seq_length * 8);
 }
 
 // Returns JUST the codeword bits (excluding flag + group bits)
-uint8_t groupCodeSize(uint8_t group) {
-    switch(group) {
-        case 0: return 4;  // 4-bit codeword
-        case 1: return 4;  // 4-bit codeword
-        case 2: return 4;  // 4-bit codeword
-        case 3: return 12; // 12-bit codeword
-        default:
-            fprintf(stderr, "Invalid group %d Exiting!\n", group);            
-            exit(0);
-            return 0;
+uint8_t groupCodeSize(const GroupLayout* layout, uint8_t group) {
+    if (group >= layout->group_count) {
+        fprintf(stderr, "Invalid group %d Exiting!\n", group);
+        exit(EXIT_FAILURE);
     }
+    return layout->code_bits[group];
 }
 
-uint16_t getGroupThreshold(uint8_t group) {
-    switch (group) {
-        case 0:
-            return 16;
-        case 1:
-            return 32;
-        case 2: 
-            return 48;
-        case 3:
-            return 4144;
-        default:
-            fprintf(stderr, "\n Illegal group of compression used \n");
-            exit(EXIT_FAILURE);
+// Returns the rank just past the last entry of group.
+uint32_t getGroupThreshold(const GroupLayout* layout, uint8_t group) {
+    if (group >= layout->group_count) {
+        fprintf(stderr, "\n Illegal group of compression used \n");
+        exit(EXIT_FAILURE);
+    }
+    uint32_t threshold = 0;
+    for (uint8_t g = 0; g <= group; g++) {
+        threshold += 1u << layout->code_bits[g];
     }
+    return threshold;
 }
 
 
-//Returns overhead of a group.
-uint8_t groupOverHead(uint8_t group) {
-	(void)group; // Suppressing unused parameter warning. In future we might need it.
-	return 3;
+//Returns overhead of a group: flag bit plus group selector.
+uint8_t groupOverHead(const GroupLayout* layout) {
+	return 1 + groupSelectorBits(layout);
 }
@@ -9,10 +9,44 @@
 
 
 #define TOTAL_GROUPS 4
+#define HEADER_LENGTH_BITS 6 // Header stores length-1 of each entry in 6 bits
+#define GROUP_COUNT_BITS 2   // Header stores group count-1
+#define GROUP_WIDTH_BITS 4   // Header stores the codeword width of each group
+#define GROUP_MAX_CODE_BITS 13
+#define GROUP_UNASSIGNED 0xFF // Group of an entry that has no codeword
+#define LITERAL_BITS 9        // Flag bit plus the byte
 
-uint8_t groupCodeSize(uint8_t group); 
-uint8_t groupOverHead(uint8_t group);
-uint8_t getHeaderOverhead(uint8_t group, uint16_t seq_length);
-uint16_t getGroupThreshold(uint8_t group);
+/**
+ * Codeword layout of a stream: group g holds the next 1 << code_bits[g] entries
+ * of the usage ranking, a token spends groupSelectorBits() on its group and then
+ * code_bits[g] on its codeword.
+ */
+typedef struct {
+    uint8_t group_count;
+    uint8_t code_bits[TOTAL_GROUPS];
+} GroupLayout;
 
-#endif
\ No newline at end of file
+// The fixed 4/4/4/12 bit layout, used before any usage is known.
+void groupLayoutDefault(GroupLayout* layout);
+
+/**
+ * Picks the group count and widths that minimise the bits spent on tokens plus the
+ * layout itself, for entries ranked by uses (highest first).
+ * @param uses Uses of each entry, sorted in decreasing order
+ * @param entry_count Entries that need a codeword
+ * @param layout Receives the layout
+ * @return 1 on success, 0 if entry_count does not fit in any layout
+ */
+int groupLayoutOptimal(const uint32_t* uses, uint32_t entry_count, GroupLayout* layout);
+
+// Returns the group of the entry ranked rank and its codeword, or GROUP_UNASSIGNED.
+uint8_t getGroupOfRank(const GroupLayout* layout, uint32_t rank, uint16_t* codeword);
+
+uint8_t groupSelectorBits(const GroupLayout* layout);
+uint8_t groupCodeSize(const GroupLayout* layout, uint8_t group);
+uint8_t groupOverHead(const GroupLayout* layout);
+uint16_t groupLayoutBits(const GroupLayout* layout);
+uint16_t getHeaderOverhead(uint16_t seq_length);
+uint32_t getGroupThreshold(const GroupLayout* layout, uint8_t group);
+
+#endif
@@ -0,0 +1,48 @@
+// match_table.c
+#include "match_table.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+static int reserve(MatchTable* table, uint32_t needed) {
+    if (needed <= table->capacity) return 1;
+    uint32_t new_capacity = table->capacity ? table->capacity : BLOCK_SIZE;
+    while (new_capacity < needed) new_capacity *= 2;
+    uint16_t* grown = realloc(table->entries, new_capacity * sizeof(uint16_t));
+    if (!grown) {
+        fprintf(stderr, "Error: Unable to grow the match table\n");
+        return 0;
+    }
+    table->entries = grown;
+    table->capacity = new_capacity;
+    return 1;
+}
+
+int match_table_fill(MatchTable* table, const AhoCorasick* matcher,
+                     const uint8_t* block, uint32_t block_size) {
+    table->block_size = MIN(block_size, (uint32_t)BLOCK_SIZE);
+
+    AcMatch matches[SEQ_LENGTH_LIMIT];
+    uint32_t state = AC_ROOT;
+    uint32_t used = 0;
+    for (uint32_t i = 0; i < table->block_size; i++) {
+        state = aho_corasick_step(matcher, state, block[i]);
+        int count = aho_corasick_matches(matcher, state, matches);
+
+        table->first_match[i] = used;
+        table->length_mask[i] = 0;
+        if (!reserve(table, used + count)) return 0;
+        for (int m = 0; m < count; m++) {
+            if (matches[m].length < SEQ_LENGTH_START) continue;
+            table->length_mask[i] |= SEQ_LENGTH_BIT(matches[m].length);
+            table->entries[used++] = matches[m].entry;
+        }
+    }
+    table->first_match[table->block_size] = used;
+    return 1;
+}
+
+void match_table_free(MatchTable* table) {
+    free(table->entries);
+    table->entries = NULL;
+    table->capacity = 0;
+}
@@ -0,0 +1,32 @@
+// match_table.h
+#ifndef MATCH_TABLE_H
+#define MATCH_TABLE_H
+
+#include <stdint.h>
+#include "../constants.h"
+#include "aho_corasick.h"
+
+/**
+ * Dictionary matches of one block, found before the graph is built.
+ * Position i lists the entries ending at block[i]: length_mask[i] has
+ * SEQ_LENGTH_BIT(len) set for each of them, and their entry ids are
+ * entries[first_match[i]..first_match[i + 1]), longest first.
+ */
+typedef struct {
+    uint64_t length_mask[BLOCK_SIZE];
+    uint32_t first_match[BLOCK_SIZE + 1];
+    uint16_t* entries;
+    uint32_t capacity;      // Allocated entries
+    uint32_t block_size;
+} MatchTable;
+
+/**
+ * Scans block once with the matcher and fills table.
+ * @return 1 on success, 0 on allocation failure
+ */
+int match_table_fill(MatchTable* table, const AhoCorasick* matcher,
+                     const uint8_t* block, uint32_t block_size);
+
+void match_table_free(MatchTable* table);
+
+#endif
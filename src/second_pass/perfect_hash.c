@@ -0,0 +1,261 @@
+// perfect_hash.c
+#include "perfect_hash.h"
+#include "seq_compare.h"
+#include "../constants.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+#define KEYS_PER_BUCKET 4       // Average bucket size
+#define MAX_SEED (1u << 22)     // Seeds tried per bucket before a new salt
+#define MAX_SALTS 16
+#define NO_SLOT UINT32_MAX
+
+struct PerfectHash {
+    PerfectHashSlot* slots;
+    uint32_t* seeds;        // Seed of each bucket
+    uint8_t* keys;          // Every key, back to back
+    uint32_t slot_count;    // Number of distinct keys
+    uint32_t bucket_count;
+    uint64_t salt;
+};
+
+static inline uint64_t mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Hash of the whole key, a word at a time; short keys are read as two overlapping words
+static inline uint64_t keyHash(const uint8_t* key, uint16_t length, uint64_t salt) {
+    uint64_t h = salt ^ (length * 0x9E3779B97F4A7C15ULL);
+    if (length >= 8) {
+        uint16_t i = 0;
+        for (; i + 8 < length; i += 8) {
+            h = (h ^ seq_load64(key + i)) * 0xC2B2AE3D27D4EB4FULL;
+            h ^= h >> 31;
+        }
+        h ^= seq_load64(key + length - 8);
+    } else if (length >= 4) {
+        h ^= seq_load32(key) | (uint64_t)seq_load32(key + length - 4) << 32;
+    } else if (length >= 2) {
+        h ^= seq_load16(key) | (uint64_t)seq_load16(key + length - 2) << 16;
+    } else if (length == 1) {
+        h ^= key[0];
+    }
+    return mix64(h);
+}
+
+static inline uint32_t bucketOf(const PerfectHash* table, uint64_t hash) {
+    return (uint32_t)(((hash >> 32) * table->bucket_count) >> 32);
+}
+
+static inline uint32_t slotOf(const PerfectHash* table, uint64_t hash, uint32_t seed) {
+    uint64_t h = mix64((uint32_t)hash ^ ((uint64_t)seed << 32));
+    return (uint32_t)(((h & 0xFFFFFFFFu) * table->slot_count) >> 32);
+}
+
+typedef struct {
+    uint64_t hash;
+    uint32_t bucket;
+    uint16_t entry;
+} Key;
+
+// By bucket, then by hash so that repeated keys end up next to each other
+static int compareKeys(const void* a, const void* b) {
+    const Key* ka = a;
+    const Key* kb = b;
+    if (ka->bucket != kb->bucket) return ka->bucket < kb->bucket ? -1 : 1;
+    if (ka->hash != kb->hash) return ka->hash < kb->hash ? -1 : 1;
+    return (int)ka->entry - (int)kb->entry;
+}
+
+typedef struct {
+    uint32_t bucket;
+    uint32_t first;    // First key of the bucket in the sorted keys
+    uint32_t size;
+} Bucket;
+
+static int compareBucketsBySize(const void* a, const void* b) {
+    const Bucket* ba = a;
+    const Bucket* bb = b;
+    if (ba->size != bb->size) return ba->size > bb->size ? -1 : 1;
+    return ba->bucket < bb->bucket ? -1 : (ba->bucket > bb->bucket);
+}
+
+static bool sameKey(const BinarySequence* entries, const Key* a, const Key* b) {
+    const BinarySequence* ea = &entries[a->entry];
+    const BinarySequence* eb = &entries[b->entry];
+    return a->hash == b->hash && ea->length == eb->length &&
+           seq_equal(ea->sequence, eb->sequence, (uint16_t)ea->length);
+}
+
+/**
+ * Places the buckets, largest first, each with the first seed that sends all its
+ * keys to free slots.
+ * @return 1 when every bucket found a seed
+ */
+static int placeBuckets(PerfectHash* table, const Key* keys, const Bucket* buckets,
+                        uint32_t bucket_count, uint32_t* owner) {
+    uint32_t placed[KEYS_PER_BUCKET * 8];
+    for (uint32_t i = 0; i < table->slot_count; i++) owner[i] = NO_SLOT;
+
+    for (uint32_t b = 0; b < bucket_count; b++) {
+        const Bucket* bucket = &buckets[b];
+        uint32_t seed = 0;
+        for (; seed < MAX_SEED; seed++) {
+            uint32_t k = 0;
+            for (; k < bucket->size; k++) {
+                uint32_t slot = slotOf(table, keys[bucket->first + k].hash, seed);
+                if (owner[slot] != NO_SLOT) break;
+                owner[slot] = bucket->first + k;
+                placed[k] = slot;
+            }
+            if (k == bucket->size) break;
+            while (k > 0) owner[placed[--k]] = NO_SLOT;
+        }
+        if (seed == MAX_SEED) return 0;
+        table->seeds[bucket->bucket] = seed;
+    }
+    return 1;
+}
+
+PerfectHash* perfect_hash_build(const BinarySequence* entries, uint16_t count) {
+    PerfectHash* table = calloc(1, sizeof(PerfectHash));
+    Key* keys = malloc((count ? count : 1) * sizeof(Key));
+    if (!table || !keys) goto fail;
+
+    size_t key_bytes = 0;
+    for (uint16_t i = 0; i < count; i++) {
+        if (entries[i].length > 0 && entries[i].length <= SEQ_LENGTH_LIMIT) key_bytes += entries[i].length;
+    }
+    table->keys = malloc(key_bytes ? key_bytes : 1);
+    if (!table->keys) goto fail;
+
+    for (uint32_t attempt = 0; attempt < MAX_SALTS; attempt++) {
+        table->salt = mix64(0x243F6A8885A308D3ULL + attempt);
+
+        uint32_t key_count = 0;
+        for (uint16_t i = 0; i < count; i++) {
+            if (entries[i].length > 0 && entries[i].length <= SEQ_LENGTH_LIMIT) key_count++;
+        }
+        table->bucket_count = key_count / KEYS_PER_BUCKET + 1;
+        key_count = 0;
+        for (uint16_t i = 0; i < count; i++) {
+            const BinarySequence* entry = &entries[i];
+            if (entry->length <= 0 || entry->length > SEQ_LENGTH_LIMIT) continue;
+            keys[key_count].hash = keyHash(entry->sequence, (uint16_t)entry->length, table->salt);
+            keys[key_count].bucket = bucketOf(table, keys[key_count].hash);
+            keys[key_count].entry = i;
+            key_count++;
+        }
+        qsort(keys, key_count, sizeof(Key), compareKeys);
+
+        // Repeated keys sit next to each other; keep the last entry of each
+        uint32_t unique = 0;
+        for (uint32_t i = 0; i < key_count; i++) {
+            if (unique > 0 && sameKey(entries, &keys[unique - 1], &keys[i])) {
+                keys[unique - 1] = keys[i];
+            } else {
+                keys[unique++] = keys[i];
+            }
+        }
+        table->slot_count = unique;
+
+        Bucket* buckets = malloc(table->bucket_count * sizeof(Bucket));
+        uint32_t* owner = malloc((unique ? unique : 1) * sizeof(uint32_t));
+        free(table->seeds);
+        table->seeds = calloc(table->bucket_count, sizeof(uint32_t));
+        if (!buckets || !owner || !table->seeds) {
+            free(buckets);
+            free(owner);
+            goto fail;
+        }
+        uint32_t bucket_count = 0;
+        bool fits = true;
+        for (uint32_t i = 0; i < unique;) {
+            uint32_t bucket = keys[i].bucket;
+            uint32_t end = i;
+            while (end < unique && keys[end].bucket == bucket) end++;
+            if (end - i > KEYS_PER_BUCKET * 8) fits = false;  // Too crowded, try another salt
+            buckets[bucket_count++] = (Bucket){bucket, i, end - i};
+            i = end;
+        }
+        qsort(buckets, bucket_count, sizeof(Bucket), compareBucketsBySize);
+
+        if (fits && placeBuckets(table, keys, buckets, bucket_count, owner)) {
+            table->slots = calloc(unique ? unique : 1, sizeof(PerfectHashSlot));
+            if (!table->slots) {
+                free(buckets);
+                free(owner);
+                goto fail;
+            }
+            uint32_t offset = 0;
+            for (uint32_t s = 0; s < unique; s++) {
+                const BinarySequence* entry = &entries[keys[owner[s]].entry];
+                PerfectHashSlot* slot = &table->slots[s];
+                memcpy(table->keys + offset, entry->sequence, entry->length);
+                memcpy(slot->head, entry->sequence, MIN(entry->length, PERFECT_HASH_INLINE_BYTES));
+                slot->key_offset = offset;
+                slot->record.entry = keys[owner[s]].entry;
+                slot->length = (uint8_t)entry->length;
+                offset += entry->length;
+            }
+            free(buckets);
+            free(owner);
+            free(keys);
+            perfect_hash_update_codes(table, entries);
+            return table;
+        }
+        free(buckets);
+        free(owner);
+    }
+    fprintf(stderr, "Error: No perfect hash found for the dictionary\n");
+
+fail:
+    free(keys);
+    perfect_hash_free(table);
+    return NULL;
+}
+
+void perfect_hash_free(PerfectHash* table) {
+    if (!table) return;
+    free(table->slots);
+    free(table->seeds);
+    free(table->keys);
+    free(table);
+}
+
+void perfect_hash_update_codes(PerfectHash* table, const BinarySequence* entries) {
+    for (uint32_t s = 0; s < table->slot_count; s++) {
+        SequenceRecord* record = &table->slots[s].record;
+        record->frequency = entries[record->entry].frequency;
+        record->group = entries[record->entry].group;
+        record->codeword = entries[record->entry].codeword;
+    }
+}
+
+void perfect_hash_update_savings(PerfectHash* table, const int32_t* savings) {
+    for (uint32_t s = 0; s < table->slot_count; s++) {
+        SequenceRecord* record = &table->slots[s].record;
+        record->savings = savings[record->entry];
+    }
+}
+
+const PerfectHashSlot* perfect_hash_find(const PerfectHash* table, const uint8_t* key, uint16_t length) {
+    if (table->slot_count == 0 || length == 0) return NULL;
+
+    uint64_t hash = keyHash(key, length, table->salt);
+    const PerfectHashSlot* slot = &table->slots[slotOf(table, hash, table->seeds[bucketOf(table, hash)])];
+    if (slot->length != length) return NULL;
+    if (length <= PERFECT_HASH_INLINE_BYTES) {
+        return seq_equal(slot->head, key, length) ? slot : NULL;
+    }
+    bool equal = seq_equal(slot->head, key, PERFECT_HASH_INLINE_BYTES) &&
+                 seq_equal(table->keys + slot->key_offset + PERFECT_HASH_INLINE_BYTES,
+                           key + PERFECT_HASH_INLINE_BYTES, length - PERFECT_HASH_INLINE_BYTES);
+    return equal ? slot : NULL;
+}
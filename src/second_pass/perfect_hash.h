@@ -0,0 +1,46 @@
+// perfect_hash.h
+#ifndef PERFECT_HASH_H
+#define PERFECT_HASH_H
+
+#include <stdint.h>
+#include "../common_types.h"
+
+#define PERFECT_HASH_INLINE_BYTES 8  // Key bytes kept in the slot itself
+
+/**
+ * Slot of a key: its first bytes, where the rest lives and the record of its
+ * entry. 32 bytes, so a slot never straddles two cache lines.
+ */
+typedef struct {
+    uint8_t head[PERFECT_HASH_INLINE_BYTES];  // First bytes of the key, zero padded
+    uint32_t key_offset;   // Start of the whole key in the key arena
+    uint8_t length;
+    uint8_t reserved[3];
+    SequenceRecord record;
+} PerfectHashSlot;
+
+/**
+ * Minimal perfect hash over a fixed set of byte sequences (hash and displace):
+ * a key hashes to a bucket, the bucket's seed moves it to its own slot. A lookup
+ * is one hash, one seed, one slot and one compare, whatever the key.
+ */
+typedef struct PerfectHash PerfectHash;
+
+/**
+ * Builds the table over the entries of length 1..SEQ_LENGTH_LIMIT. A repeated key
+ * belongs to its last entry.
+ * @return The table, or NULL on allocation failure
+ */
+PerfectHash* perfect_hash_build(const BinarySequence* entries, uint16_t count);
+void perfect_hash_free(PerfectHash* table);
+
+// Copies frequency, group and codeword of every entry into its slot's record.
+void perfect_hash_update_codes(PerfectHash* table, const BinarySequence* entries);
+
+// Sets the saving in every slot's record from savings, indexed by entry.
+void perfect_hash_update_savings(PerfectHash* table, const int32_t* savings);
+
+// Returns the slot of the key, or NULL if the key is not in the table.
+const PerfectHashSlot* perfect_hash_find(const PerfectHash* table, const uint8_t* key, uint16_t length);
+
+#endif
@@ -3,10 +3,10 @@
 #include "prune_logic.h"
 #include <math.h>
 #include <limits.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h> // For memcpy
-#include <stdlib.h>
 
 #define SELECTION_SORT_THRESHOLD 32
 
@@ -21,10 +21,9 @@
  *
  * @param new_bin_seq The binary sequence to evaluate
  * @param seq_length Length of the sequence
- * @param map Hashmap containing frequency counts
  * @return Calculated savings value, or INT_MIN on error
  */
-int32_t calculate_savings(const uint8_t* new_bin_seq, uint16_t seq_length, BinSeqMap* map) {
+int32_t calculate_savings(const uint8_t* new_bin_seq, uint16_t seq_length) {
     // Validate inputs
     if (!new_bin_seq || seq_length <= 0) {
         fprintf(stderr, "Error: Invalid parameters in calculate_savings\n");
@@ -36,18 +35,67 @@ int32_t calculate_savings(const uint8_t* new_bin_seq, uint16_t seq_length, BinSe
         return 0;
     }
 
-    // Lookup frequency of the sequence from the hashmap
-    //const int* freq_ptr = map == NULL? 0: binseq_map_get_frequency(map, new_bin_seq, seq_length);
-    int frequency = 0;//freq_ptr ? *freq_ptr : 0;
-    if (frequency == 0) {
-        return seq_length*5;
+    // Without a dictionary every sequence is a candidate
+    return seq_length*5;
+}
+
+#define SAVINGS_EXACT_BITS 10  // log2(SAVINGS_EXACT_FREQUENCIES)
+#define SAVINGS_BUCKET_BITS 5   // log2(SAVINGS_BUCKETS_PER_OCTAVE)
+#define SAVINGS_COLUMNS (SAVINGS_EXACT_FREQUENCIES + \
+                         (31 - SAVINGS_EXACT_BITS) * SAVINGS_BUCKETS_PER_OCTAVE)
+
+// The two factors of the power model, length^1.3 and (frequency + 1)^1.8 per column
+static double length_power[SEQ_LENGTH_LIMIT + 1];
+static double frequency_power[SAVINGS_COLUMNS];
+static bool power_tables_ready = false;
+
+// Column of a frequency: itself while small, then its top SAVINGS_BUCKET_BITS + 1 bits
+static inline uint32_t frequencyColumn(uint32_t frequency) {
+    if (frequency < SAVINGS_EXACT_FREQUENCIES) {
+        return frequency;
+    }
+    uint32_t octave = 31 - (uint32_t)__builtin_clz(frequency);
+    uint32_t step = (frequency >> (octave - SAVINGS_BUCKET_BITS)) & (SAVINGS_BUCKETS_PER_OCTAVE - 1);
+    return SAVINGS_EXACT_FREQUENCIES + (octave - SAVINGS_EXACT_BITS) * SAVINGS_BUCKETS_PER_OCTAVE + step;
+}
+
+// Lowest frequency of a column
+static uint32_t columnFrequency(uint32_t column) {
+    if (column < SAVINGS_EXACT_FREQUENCIES) {
+        return column;
     }
-    double savings = (double)(pow(frequency+1, 1.8))*(pow(seq_length, 1.3));
-    
-    /**
-     * Safety Cap:
-     * - Ensures theoretical limits are respected
-     */
+    column -= SAVINGS_EXACT_FREQUENCIES;
+    uint32_t octave = column / SAVINGS_BUCKETS_PER_OCTAVE + SAVINGS_EXACT_BITS;
+    uint32_t step = column % SAVINGS_BUCKETS_PER_OCTAVE;
+    return (SAVINGS_BUCKETS_PER_OCTAVE + step) << (octave - SAVINGS_BUCKET_BITS);
+}
+
+// One pow() per length and per column; a saving is then a single product
+static void buildPowerTables(void) {
+    for (uint16_t len = 0; len <= SEQ_LENGTH_LIMIT; len++) {
+        length_power[len] = pow(len, 1.3);
+    }
+    for (uint32_t column = 0; column < SAVINGS_COLUMNS; column++) {
+        frequency_power[column] = pow(columnFrequency(column) + 1, 1.8);
+    }
+    power_tables_ready = true;
+}
+
+int32_t calculate_savings_for_frequency(uint16_t seq_length, int frequency) {
+    if (frequency <= 0 || seq_length > SEQ_LENGTH_LIMIT) {
+        return 0;
+    }
+    if (!power_tables_ready) {
+        buildPowerTables();
+    }
+    double savings = frequency_power[frequencyColumn((uint32_t)frequency)] * length_power[seq_length];
     return (int32_t)MIN(savings, INT32_MAX);
 }
 
+int32_t calculate_bit_savings(uint16_t seq_length, uint8_t token_bits, int header_uses) {
+    int32_t savings = (int32_t)seq_length * LITERAL_BITS - token_bits;
+    if (header_uses > 0) {
+        savings -= (getHeaderOverhead(seq_length) + header_uses - 1) / header_uses;
+    }
+    return savings;
+}
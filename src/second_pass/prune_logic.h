@@ -4,7 +4,7 @@
 #define PRUNE_LOGIC_H
 
 
-#include "binseq_hashmap.h"
+#include "group.h"
 #include "../constants.h"
 
 
@@ -17,9 +17,27 @@
  * Calculates the potential savings from compressing a binary sequence
  * @param new_bin_seq The binary sequence to evaluate
  * @param seq_length Length of the sequence
- * @param map Hashmap containing frequency data of sequences
- * @return Calculated savings value (higher means more beneficial to compress)
+ * @return Calculated savings value (higher means more beneficial to compress, 0 if not encodable)
  */
-int32_t calculate_savings(const uint8_t* seq, uint16_t len, BinSeqMap* map);
+int32_t calculate_savings(const uint8_t* seq, uint16_t len);
+
+/**
+ * Savings of a dictionary sequence of len seen frequency times (0 if never seen):
+ * (frequency + 1)^1.8 * len^1.3, frequencies bucketed as below. Both factors come
+ * from small tables built on first use.
+ */
+int32_t calculate_savings_for_frequency(uint16_t len, int frequency);
+
+/**
+ * Exact bits saved each time an entry of len is written as a token of token_bits
+ * instead of as literals. With header_uses > 0 the entry also pays for its header
+ * bits (getHeaderOverhead), spread over that many uses.
+ */
+int32_t calculate_bit_savings(uint16_t len, uint8_t token_bits, int header_uses);
+
+// Frequencies below this have a table column each; larger ones share
+// SAVINGS_BUCKETS_PER_OCTAVE columns per power of two, valued at their lowest frequency.
+#define SAVINGS_EXACT_FREQUENCIES 1024
+#define SAVINGS_BUCKETS_PER_OCTAVE 32
 
 #endif // PRUNE_LOGIC_H
@@ -0,0 +1,49 @@
+// select.c
+#include "select.h"
+#include <stdint.h>
+#include <string.h>
+
+#define SWAP_CHUNK 32
+
+static void swap_elements(uint8_t* a, uint8_t* b, size_t size) {
+    if (a == b) return;
+    uint8_t tmp[SWAP_CHUNK];
+    while (size > 0) {
+        size_t chunk = size < SWAP_CHUNK ? size : SWAP_CHUNK;
+        memcpy(tmp, a, chunk);
+        memcpy(a, b, chunk);
+        memcpy(b, tmp, chunk);
+        a += chunk;
+        b += chunk;
+        size -= chunk;
+    }
+}
+
+void select_best(void* base, size_t n, size_t size, size_t k,
+                 int (*compare)(const void*, const void*)) {
+    uint8_t* items = base;
+    size_t lo = 0;
+    size_t hi = n;
+    while (hi - lo > 1 && lo < k && k < hi) {
+        // Median of three as pivot, parked at hi - 1
+        uint8_t* first = items + lo * size;
+        uint8_t* mid = items + (lo + (hi - lo) / 2) * size;
+        uint8_t* last = items + (hi - 1) * size;
+        if (compare(mid, first) < 0) swap_elements(mid, first, size);
+        if (compare(last, first) < 0) swap_elements(last, first, size);
+        if (compare(mid, last) < 0) swap_elements(mid, last, size);
+
+        size_t store = lo;
+        for (size_t i = lo; i < hi - 1; i++) {
+            if (compare(items + i * size, last) < 0) swap_elements(items + i * size, items + store++ * size, size);
+        }
+        swap_elements(items + store * size, last, size);
+
+        // base[lo..store) beat the pivot, now at store; the rest lose to it
+        if (store >= k) {
+            hi = store;
+        } else {
+            lo = store + 1;
+        }
+    }
+}
@@ -0,0 +1,16 @@
+// select.h
+#ifndef SELECT_H
+#define SELECT_H
+
+#include <stddef.h>
+
+/**
+ * Quickselect with a median-of-three pivot: moves the k elements of base[0..n) that
+ * come first in the order of compare (as for qsort) to the front, in no particular
+ * order. Runs in O(n) on average, against O(n log n) for sorting everything.
+ * @param size Bytes per element
+ */
+void select_best(void* base, size_t n, size_t size, size_t k,
+                 int (*compare)(const void*, const void*));
+
+#endif
@@ -0,0 +1,150 @@
+// seq_compare.c
+#include "seq_compare.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define SEQ_COMPARE_X86 1
+#include <immintrin.h>
+#endif
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define SEQ_COMPARE_WORDS 1  // The first differing byte is the lowest set byte of a XOR
+#endif
+
+static bool equalResolve(const uint8_t* a, const uint8_t* b, uint16_t length);
+static uint16_t prefixResolve(const uint8_t* a, const uint8_t* b, uint16_t length);
+
+bool (*seq_equal_long)(const uint8_t*, const uint8_t*, uint16_t) = equalResolve;
+static uint16_t (*prefix_long)(const uint8_t*, const uint8_t*, uint16_t) = prefixResolve;
+static const char* kernel_name = NULL;
+
+// Scalar kernels: words, the last one overlapping the previous
+static bool equalScalar(const uint8_t* a, const uint8_t* b, uint16_t length) {
+    for (uint16_t i = 0; i + 8 < length; i += 8) {
+        if (seq_load64(a + i) != seq_load64(b + i)) return false;
+    }
+    return seq_load64(a + length - 8) == seq_load64(b + length - 8);
+}
+
+static uint16_t prefixScalar(const uint8_t* a, const uint8_t* b, uint16_t length) {
+    uint16_t i = 0;
+#ifdef SEQ_COMPARE_WORDS
+    for (; i + 8 <= length; i += 8) {
+        uint64_t diff = seq_load64(a + i) ^ seq_load64(b + i);
+        if (diff) return i + (uint16_t)(__builtin_ctzll(diff) / 8);
+    }
+#endif
+    while (i < length && a[i] == b[i]) i++;
+    return i;
+}
+
+#ifdef SEQ_COMPARE_X86
+// Bit i set when byte i of the two 16-byte vectors differs
+__attribute__((target("sse2")))
+static inline uint32_t diff16(const uint8_t* a, const uint8_t* b) {
+    __m128i va = _mm_loadu_si128((const __m128i*)a);
+    __m128i vb = _mm_loadu_si128((const __m128i*)b);
+    return ~(uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) & 0xFFFFu;
+}
+
+__attribute__((target("avx2")))
+static inline uint32_t diff32(const uint8_t* a, const uint8_t* b) {
+    __m256i va = _mm256_loadu_si256((const __m256i*)a);
+    __m256i vb = _mm256_loadu_si256((const __m256i*)b);
+    return ~(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(va, vb));
+}
+
+__attribute__((target("sse2")))
+static bool equalSse2(const uint8_t* a, const uint8_t* b, uint16_t length) {
+    for (uint16_t i = 0; i + 16 < length; i += 16) {
+        if (diff16(a + i, b + i)) return false;
+    }
+    return !diff16(a + length - 16, b + length - 16);
+}
+
+/**
+ * The tail is the last full vector; its bytes before done were compared already
+ * and are masked out by the shift.
+ */
+__attribute__((target("sse2")))
+static uint16_t prefixSse2(const uint8_t* a, const uint8_t* b, uint16_t length) {
+    uint16_t done = 0;
+    for (; done + 16 <= length; done += 16) {
+        uint32_t diff = diff16(a + done, b + done);
+        if (diff) return done + (uint16_t)__builtin_ctz(diff);
+    }
+    if (done < length) {
+        uint16_t start = length - 16;
+        uint32_t diff = diff16(a + start, b + start) >> (done - start);
+        if (diff) return done + (uint16_t)__builtin_ctz(diff);
+    }
+    return length;
+}
+
+__attribute__((target("avx2")))
+static bool equalAvx2(const uint8_t* a, const uint8_t* b, uint16_t length) {
+    if (length < 32) {
+        return !(diff16(a, b) | diff16(a + length - 16, b + length - 16));
+    }
+    for (uint16_t i = 0; i + 32 < length; i += 32) {
+        if (diff32(a + i, b + i)) return false;
+    }
+    return !diff32(a + length - 32, b + length - 32);
+}
+
+__attribute__((target("avx2")))
+static uint16_t prefixAvx2(const uint8_t* a, const uint8_t* b, uint16_t length) {
+    if (length < 32) return prefixSse2(a, b, length);
+    uint16_t done = 0;
+    for (; done + 32 <= length; done += 32) {
+        uint32_t diff = diff32(a + done, b + done);
+        if (diff) return done + (uint16_t)__builtin_ctz(diff);
+    }
+    if (done < length) {
+        uint16_t start = length - 32;
+        uint32_t diff = diff32(a + start, b + start) >> (done - start);
+        if (diff) return done + (uint16_t)__builtin_ctz(diff);
+    }
+    return length;
+}
+#endif
+
+// Picks the widest kernel the CPU runs, so one binary serves older hosts too
+static void pickKernels(void) {
+#ifdef SEQ_COMPARE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        seq_equal_long = equalAvx2;
+        prefix_long = prefixAvx2;
+        kernel_name = "avx2";
+        return;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        seq_equal_long = equalSse2;
+        prefix_long = prefixSse2;
+        kernel_name = "sse2";
+        return;
+    }
+#endif
+    seq_equal_long = equalScalar;
+    prefix_long = prefixScalar;
+    kernel_name = "scalar";
+}
+
+static bool equalResolve(const uint8_t* a, const uint8_t* b, uint16_t length) {
+    pickKernels();
+    return seq_equal_long(a, b, length);
+}
+
+static uint16_t prefixResolve(const uint8_t* a, const uint8_t* b, uint16_t length) {
+    pickKernels();
+    return prefix_long(a, b, length);
+}
+
+uint16_t seq_common_prefix(const uint8_t* a, const uint8_t* b, uint16_t length) {
+    return length >= 16 ? prefix_long(a, b, length) : prefixScalar(a, b, length);
+}
+
+const char* seq_compare_kernel(void) {
+    if (!kernel_name) pickKernels();
+    return kernel_name;
+}
@@ -0,0 +1,46 @@
+// seq_compare.h
+#ifndef SEQ_COMPARE_H
+#define SEQ_COMPARE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/**
+ * Compares of byte sequences up to SEQ_LENGTH_LIMIT bytes long. From 16 bytes on
+ * a vector kernel (AVX2 or SSE2, picked from the CPU on first use) does the work;
+ * shorter sequences are compared as two overlapping words. No kernel reads outside
+ * [a, a + length) or [b, b + length).
+ */
+
+// Unaligned loads, also used to hash short keys
+static inline uint64_t seq_load64(const uint8_t* p) { uint64_t v; memcpy(&v, p, 8); return v; }
+static inline uint32_t seq_load32(const uint8_t* p) { uint32_t v; memcpy(&v, p, 4); return v; }
+static inline uint16_t seq_load16(const uint8_t* p) { uint16_t v; memcpy(&v, p, 2); return v; }
+
+// Kernel for sequences of 16 bytes or more
+extern bool (*seq_equal_long)(const uint8_t* a, const uint8_t* b, uint16_t length);
+
+static inline bool seq_equal(const uint8_t* a, const uint8_t* b, uint16_t length) {
+    if (length >= 16) return seq_equal_long(a, b, length);
+    if (length >= 8) {
+        return seq_load64(a) == seq_load64(b) && seq_load64(a + length - 8) == seq_load64(b + length - 8);
+    }
+    if (length >= 4) {
+        return seq_load32(a) == seq_load32(b) && seq_load32(a + length - 4) == seq_load32(b + length - 4);
+    }
+    if (length >= 2) {
+        return seq_load16(a) == seq_load16(b) && seq_load16(a + length - 2) == seq_load16(b + length - 2);
+    }
+    return length == 0 || a[0] == b[0];
+}
+
+/**
+ * @return Number of leading bytes a and b have in common, at most length
+ */
+uint16_t seq_common_prefix(const uint8_t* a, const uint8_t* b, uint16_t length);
+
+// Name of the kernel in use: "avx2", "sse2" or "scalar"
+const char* seq_compare_kernel(void);
+
+#endif
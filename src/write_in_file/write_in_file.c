@@ -4,6 +4,7 @@
 #include <string.h>
 #include <limits.h> 
 #include "write_in_file.h"
+#include "../constants.h"
 
 
 #define BUFFER_SIZE (1024 * 1024)  // 1MB buffer for better I/O performance
@@ -61,7 +62,7 @@ static inline void write_bit(uint8_t bit, uint8_t* buffer, uint8_t* bit_pos,
  /**
  * @brief Writes compressed data to a file with proper flagging and bit-level organization.
  * 
- * This function processes compressed sequences from a TreeNode and writes them to a file
+ * This function processes the token lengths of a CompressPath and writes them to a file
  * with precise bit-level formatting to distinguish between compressed and uncompressed data.
  * 
  * Data Format Rules:
@@ -72,12 +73,14 @@ static inline void write_bit(uint8_t bit, uint8_t* buffer, uint8_t* bit_pos,
  * 
  * 2. For compressed sequences:
  *    - Sequence starts with '1' flag (1 bit)
- *    - Followed by 2-bit group ID (values 0-3)
- *    - Then the actual codeword (groupCodeSize(group))
- * @param node The TreeNode containing compression metadata with:
+ *    - Followed by the group ID (groupSelectorBits(layout), none for a single group)
+ *    - Then the actual codeword (groupCodeSize(layout, group))
+ * @param path The CompressPath containing compression metadata with:
  *             - compress_sequence: Array of sequence lengths
  *             - compress_sequence_count: Valid entries in compress_sequence
  * @param block Source data block containing raw bytes to compress
+ * @param block_size Number of bytes in block
+ * @param dict Dictionary providing group and codeword of compressed sequences
  * @param file Output file handle (must be open for binary writing)
  * 
  * @note Important Implementation Details:
@@ -89,21 +92,22 @@ static inline void write_bit(uint8_t bit, uint8_t* buffer, uint8_t* bit_pos,
  * @example 
  *   Uncompressed "AB" (2 bytes):
  *     Writes: 0 01000001 0 01000010 (18 bits)
- *   Compressed sequence (group 1):
+ *   Compressed sequence (group 1 of the default 4/4/4/12 layout):
  *     Writes: 1 01 [4-bit codeword] (7 bits total)
 */
 /**
  * @brief Writes compressed data to a file with extensive debugging output
  */
-static void writeCompressedDataInFile(TreeNode *node, const uint8_t* block, FILE *file) {
-    if (!node || !block || !file) {
+static void writeCompressedDataInFile(const CompressPath *path, const uint8_t* block, size_t block_size,
+                                      const Dictionary* dict, FILE *file) {
+    if (!path || !block || !file) {
         fprintf(stderr, "Error: Invalid inputs in writeCompressedDataInFile\n");
         return;
     }
 
     #ifdef DEBUG
     printf("\n=== Starting writeCompressedDataInFile ===\n");
-    printf("Node has %d sequences to process\n", node->compress_sequence_count);
+    printf("Path has %u sequences to process\n", path->compress_sequence_count);
     #endif
 
     uint8_t bit_buffer = 0;
@@ -111,12 +115,14 @@ static void writeCompressedDataInFile(TreeNode *node, const uint8_t* block, FILE
     uint8_t* byte_buffer = create_aligned_buffer();
     size_t byte_pos = 0;
 
-    uint32_t block_pos = 0;
-    for (int i = 0; i < node->compress_sequence_count; i++) {
-        uint16_t seq_len = node->compress_sequence[i];
+    const GroupLayout* layout = &dict->layout;
+    uint8_t selector_bits = groupSelectorBits(layout);
+    size_t block_pos = 0;
+    for (uint32_t i = 0; i < path->compress_sequence_count; i++) {
+        uint16_t seq_len = path->compress_sequence[i];
         
         #ifdef DEBUG
-        printf("\n[Sequence %d] Start processing (len=%d)\n", i, seq_len);
+        printf("\n[Sequence %u] Start processing (len=%d)\n", i, seq_len);
         #endif
 
         if (seq_len == 0 || seq_len > SEQ_LENGTH_LIMIT) {
@@ -126,33 +132,36 @@ static void writeCompressedDataInFile(TreeNode *node, const uint8_t* block, FILE
             continue;
         }
 
-        uint8_t sequence[SEQ_LENGTH_LIMIT];
-        if (block_pos + seq_len > BLOCK_SIZE) {
+        if (block_pos + seq_len > block_size) {
             #ifdef DEBUG
-            fprintf(stderr, "Error: Block overflow at position %u\n", block_pos);
+            fprintf(stderr, "Error: Block overflow at position %zu\n", block_pos);
             #endif
             break;
         }
-        memcpy(sequence, block + block_pos, seq_len);
+        const uint8_t* sequence = block + block_pos;
         block_pos += seq_len;
 
-        BinarySequence* bin_seq = NULL;//lookupSequence(sequence, seq_len);
+        // The frozen slot carries the record, group and codeword included, next to the key
+        const PerfectHashSlot* slot = seq_len > 1 ? dictionary_find(dict, sequence, seq_len) : NULL;
+        const SequenceRecord* token = slot ? &slot->record : NULL;
+        if (token && token->group >= layout->group_count) {
+            token = NULL;  // No codeword, write it as literals
+        }
 
         #ifdef DEBUG
         printf("Current bit state: buffer=%02X pos=%d\n", bit_buffer, bit_pos);
         #endif
 
-        if (!bin_seq) {
+        if (!token) {
             #ifdef DEBUG
             printf("[UNCOMPRESSED] Seq len %d: ", seq_len);
             for (int j = 0; j < seq_len; j++) printf("%02X ", sequence[j]);
             printf("\n");
-            printf("Writing flag bit 0\n");
             #endif
             
-            write_bit(0, &bit_buffer, &bit_pos, file, byte_buffer, &byte_pos);
-            
+            // Every literal byte carries its own flag bit
             for (int j = 0; j < seq_len; j++) {
+                write_bit(0, &bit_buffer, &bit_pos, file, byte_buffer, &byte_pos);
                 #ifdef DEBUG
                 printf("Byte %d/%d (%02X): ", j+1, seq_len, sequence[j]);
                 #endif
@@ -170,30 +179,29 @@ static void writeCompressedDataInFile(TreeNode *node, const uint8_t* block, FILE
         } else {
             #ifdef DEBUG
             printf("[COMPRESSED] Found in dictionary: ");
-            for (int j = 0; j < bin_seq->length; j++) printf("%02X ", bin_seq->sequence[j]);
+            for (int j = 0; j < seq_len; j++) printf("%02X ", sequence[j]);
             printf("| group=%d codeword=%d (size=%d bits)\n", 
-                  bin_seq->group, bin_seq->codeword, groupCodeSize(bin_seq->group));
+                  token->group, token->codeword, groupCodeSize(layout, token->group));
             printf("Writing flag bit 1\n");
             #endif
             
             write_bit(1, &bit_buffer, &bit_pos, file, byte_buffer, &byte_pos);
             
             // Write group bits
-            uint8_t group_bit1 = (bin_seq->group >> 1) & 1;
-            uint8_t group_bit0 = bin_seq->group & 1;
             #ifdef DEBUG
-            printf("Writing group %d as bits: %d%d\n", bin_seq->group, group_bit1, group_bit0);
+            printf("Writing group %d in %d bits\n", token->group, selector_bits);
             #endif
-            write_bit(group_bit1, &bit_buffer, &bit_pos, file, byte_buffer, &byte_pos);
-            write_bit(group_bit0, &bit_buffer, &bit_pos, file, byte_buffer, &byte_pos);
+            for (int k = selector_bits - 1; k >= 0; k--) {
+                write_bit((token->group >> k) & 1, &bit_buffer, &bit_pos, file, byte_buffer, &byte_pos);
+            }
             
             // Write codeword
-            uint8_t code_size = groupCodeSize(bin_seq->group);
+            uint8_t code_size = groupCodeSize(layout, token->group);
             #ifdef DEBUG
-            printf("Writing codeword %d (%d bits): ", bin_seq->codeword, code_size);
+            printf("Writing codeword %d (%d bits): ", token->codeword, code_size);
             #endif
             for (int k = code_size - 1; k >= 0; k--) {
-                uint8_t bit = (bin_seq->codeword >> k) & 1;
+                uint8_t bit = (token->codeword >> k) & 1;
                 #ifdef DEBUG
                 printf("%d", bit);
                 #endif
@@ -206,7 +214,7 @@ static void writeCompressedDataInFile(TreeNode *node, const uint8_t* block, FILE
 
         #ifdef DEBUG
         // Show buffer state after each sequence
-        printf("After sequence %d: bit_buffer=%02X bit_pos=%d byte_pos=%zu\n",
+        printf("After sequence %u: bit_buffer=%02X bit_pos=%d byte_pos=%zu\n",
               i, bit_buffer, bit_pos, byte_pos);
         
         /* Show complete bytes when buffer reaches certain points
@@ -254,17 +262,40 @@ static void writeCompressedDataInFile(TreeNode *node, const uint8_t* block, FILE
  * 
  * Structure:
  * 1. 2-byte sequence count (big-endian)
- * 2. For each sequence:
- *    - 3-bit length
+ * 2. Group layout: 2-bit group count-1, then a 4-bit codeword width per group
+ * 3. For each used sequence, in codeword order (group 0 codeword 0 first):
+ *    - 6-bit length-1
  *    - N bytes of sequence data
- *    - 2-bit group
- *    - Variable-length codeword
  * 
  * Note: Final byte is padded with zeros if needed for byte alignment
+ * @return 1 on success, 0 if the used sequences do not have consecutive codewords
  */
-static void writeHeaderOfCompressedFile(BinarySequence** topBinarySeq, int seq_count,
-                                      uint16_t used_seq_count, FILE* file) {
-    if (!topBinarySeq || seq_count <= 0 || !file) return;
+static int writeHeaderOfCompressedFile(const Dictionary* dict, uint16_t used_seq_count, FILE* file) {
+    if (!file || !dict) return 0;
+
+    // Entries are written by rank, which gives back their group and codeword
+    const BinarySequence **by_rank = calloc(used_seq_count ? used_seq_count : 1, sizeof(BinarySequence*));
+    if (!by_rank) {
+        fprintf(stderr, "Error: Failed to allocate header order\n");
+        return 0;
+    }
+    const GroupLayout* layout = &dict->layout;
+    for (uint16_t i = 0; i < dict->count; i++) {
+        const BinarySequence *seq = &dict->entries[i];
+        if (!seq->isUsed) continue;
+        if (seq->group >= layout->group_count) {
+            free(by_rank);
+            fprintf(stderr, "Error: Used sequence %u has no codeword\n", i);
+            return 0;
+        }
+        uint32_t rank = (seq->group ? getGroupThreshold(layout, seq->group - 1) : 0) + seq->codeword;
+        if (rank >= used_seq_count || by_rank[rank]) {
+            free(by_rank);
+            fprintf(stderr, "Error: Used sequences do not have consecutive codewords\n");
+            return 0;
+        }
+        by_rank[rank] = seq;
+    }
     
     #ifdef DEBUG
     printf("=== Writing Header ===\n");
@@ -284,11 +315,18 @@ static void writeHeaderOfCompressedFile(BinarySequence** topBinarySeq, int seq_c
     uint8_t byte_buffer[BUFFER_SIZE];
     size_t byte_pos = 0;
 
-    for (int i = 0; i < seq_count; i++) {
-        if (!topBinarySeq[i] || !topBinarySeq[i]->isUsed) continue;
+    write_bits(layout->group_count - 1, GROUP_COUNT_BITS, &bit_buffer, &bit_pos, byte_buffer, &byte_pos);
+    for (uint8_t g = 0; g < layout->group_count; g++) {
+        write_bits(layout->code_bits[g], GROUP_WIDTH_BITS, &bit_buffer, &bit_pos, byte_buffer, &byte_pos);
+    }
+    #ifdef DEBUG
+    printf("Layout: %d groups, widths", layout->group_count);
+    for (uint8_t g = 0; g < layout->group_count; g++) printf(" %d", layout->code_bits[g]);
+    printf("\n");
+    #endif
 
-        BinarySequence *seq = topBinarySeq[i];
-        uint8_t code_size = groupCodeSize(seq->group);
+    for (uint16_t i = 0; i < used_seq_count; i++) {
+        const BinarySequence *seq = by_rank[i];
         
         #ifdef DEBUG
         printf("\nSequence %d: ", i);
@@ -296,11 +334,11 @@ static void writeHeaderOfCompressedFile(BinarySequence** topBinarySeq, int seq_c
         printf("(len:%d group:%d codeword:%d)\n", seq->length, seq->group, seq->codeword);
         #endif
 
-        // 1. Write 3-bit length
+        // 1. Write 6-bit length-1
         #ifdef DEBUG
         printf("Writing length (%d): ", seq->length);
         #endif
-        write_bits(seq->length, 3, &bit_buffer, &bit_pos, byte_buffer, &byte_pos);
+        write_bits(seq->length - 1, HEADER_LENGTH_BITS, &bit_buffer, &bit_pos, byte_buffer, &byte_pos);
         
         #ifdef DEBUG
         printf("-> buffer: %02X, pos: %d\n", bit_buffer, bit_pos);
@@ -329,22 +367,6 @@ static void writeHeaderOfCompressedFile(BinarySequence** topBinarySeq, int seq_c
             }
         }
 
-        // 3. Write 2-bit group
-        #ifdef DEBUG
-        printf("Writing group (%d): ", seq->group);
-        #endif
-        write_bits(seq->group, 2, &bit_buffer, &bit_pos, byte_buffer, &byte_pos);
-        
-        #ifdef DEBUG
-        printf("-> buffer: %02X, pos: %d\n", bit_buffer, bit_pos);
-        #endif
-
-        // 4. Write codeword
-        #ifdef DEBUG
-        printf("Writing codeword (%d, %d bits): ", seq->codeword, code_size);
-        #endif
-        write_bits(seq->codeword, code_size, &bit_buffer, &bit_pos, byte_buffer, &byte_pos);
-        
         #ifdef DEBUG
         printf("-> buffer: %02X, pos: %d\n", bit_buffer, bit_pos);
         printf("Current bytes:");
@@ -371,6 +393,83 @@ static void writeHeaderOfCompressedFile(BinarySequence** topBinarySeq, int seq_c
     #endif
 
     fwrite(byte_buffer, 1, byte_pos, file);
+    free(by_rank);
+    return 1;
+}
+
+uint64_t countCompressedBits(const Dictionary* dict, bool shared, const CompressPath* path,
+                            const uint8_t* raw_data, size_t data_size, StreamBits* bits) {
+    const GroupLayout* layout = &dict->layout;
+    uint64_t header_bits = 0;
+    uint64_t entry_bits = 0;
+    if (shared) {
+        header_bits = 8 * 7;  // Marker, id and end marker
+    } else {
+        entry_bits = groupLayoutBits(layout);
+        for (uint16_t i = 0; i < dict->count; i++) {
+            if (dict->entries[i].isUsed) entry_bits += getHeaderOverhead(dict->entries[i].length);
+        }
+        header_bits = 16 + entry_bits + 8;  // Count, layout and entries, end marker
+    }
+
+    uint64_t data_bits = 0;
+    size_t pos = 0;
+    for (uint32_t i = 0; i < path->compress_sequence_count && pos < data_size; i++) {
+        uint16_t seq_len = path->compress_sequence[i];
+        if (seq_len == 0 || seq_len > SEQ_LENGTH_LIMIT || pos + seq_len > data_size) break;
+        const PerfectHashSlot* slot = seq_len > 1 ? dictionary_find(dict, raw_data + pos, seq_len) : NULL;
+        if (slot && slot->record.group < layout->group_count) {
+            data_bits += groupOverHead(layout) + groupCodeSize(layout, slot->record.group);
+        } else {
+            data_bits += (uint64_t)seq_len * LITERAL_BITS;
+        }
+        pos += seq_len;
+    }
+
+    if (bits) {
+        bits->header_bits = header_bits;
+        bits->data_bits = data_bits;
+    }
+    uint64_t header_bytes = shared ? 7 : 2 + (entry_bits + 7) / 8 + 1;
+    return header_bytes + (data_bits + 7) / 8;
+}
+
+/**
+ * @brief Writes the header of a file compressed with a shared dictionary
+ * 
+ * Structure:
+ * 1. 2-byte DICT_REFERENCE_MARKER in place of the sequence count
+ * 2. 4-byte dictionary id (big-endian)
+ * 3. End marker 0xFF
+ */
+static void writeDictionaryReference(uint32_t dict_id, FILE* file) {
+    uint8_t reference[7] = {DICT_REFERENCE_MARKER >> 8, DICT_REFERENCE_MARKER & 0xFF,
+                            dict_id >> 24, (dict_id >> 16) & 0xFF, (dict_id >> 8) & 0xFF,
+                            dict_id & 0xFF, 0xFF};
+    #ifdef DEBUG
+    printf("=== Writing Dictionary Reference %08X ===\n", dict_id);
+    #endif
+    fwrite(reference, 1, sizeof(reference), file);
+}
+
+uint64_t storedOutputSize(size_t data_size) {
+    return 2 + (uint64_t)data_size;
+}
+
+/**
+ * @brief Writes a file that holds the input uncompressed
+ * 
+ * Structure:
+ * 1. 2-byte DICT_STORED_MARKER in place of the sequence count
+ * 2. The input bytes
+ */
+static void writeStoredCopy(const uint8_t* raw_data, size_t data_size, FILE* file) {
+    uint8_t marker[2] = {DICT_STORED_MARKER >> 8, DICT_STORED_MARKER & 0xFF};
+    #ifdef DEBUG
+    printf("=== Writing Stored Copy of %zu bytes ===\n", data_size);
+    #endif
+    fwrite(marker, 1, sizeof(marker), file);
+    fwrite(raw_data, 1, data_size, file);
 }
 
 /**
@@ -398,92 +497,78 @@ static void write_bits(uint16_t value, uint8_t num_bits, uint8_t* bit_buffer, ui
 }
 
 /**
- * @brief Calculates used sequences and assigns group IDs/codewords
+ * @brief Marks the dictionary sequences used by the parse and counts their uses
+ * 
+ * Sets isUsed and count of every entry in dict; group and codeword are left as assigned.
  * 
- * @param node TreeNode containing compression sequences
- * @param block Raw data block
- * @param block_index Starting index in block
+ * @param path Parse whose tokens are looked up in the dictionary
+ * @param block Raw data
+ * @param block_size Size of the raw data
+ * @param dict Dictionary the parse was built against
  * @return int Number of used sequences found (or -1 on error)
  */
-static int calcUsedAndAssignGroupID(TreeNode *node, const uint8_t* block, uint32_t block_index) {
+int calcUsedSequences(const CompressPath *path, const uint8_t* block, size_t block_size,
+                      Dictionary* dict) {
     // Validate inputs
-    if (!node || !block) {
-        fprintf(stderr, "Error: Invalid node or block pointer\n");
-        return -1;
-    }
-    
-    if (block_index >= BLOCK_SIZE) {
-        fprintf(stderr, "Error: Block index out of bounds\n");
+    if (!path || !block || !dict) {
+        fprintf(stderr, "Error: Invalid path, block or dictionary pointer\n");
         return -1;
     }
-
-    // Initialize codeword counters for each group
-    uint16_t next_codeword[TOTAL_GROUPS] = {0};  // Groups 0-3
+    size_t block_index = 0;
     int used_count = 0;
+    uint16_t used_per_group[TOTAL_GROUPS] = {0};
+    const GroupLayout* layout = &dict->layout;
+
+    for (uint16_t i = 0; i < dict->count; i++) {
+        dict->entries[i].isUsed = 0;
+        dict->entries[i].count = 0;
+    }
 
-    // Process each sequence in the node
-    for (int i = 0; i < node->compress_sequence_count; i++) {
-        uint16_t seq_len = node->compress_sequence[i];
+    // Process each sequence in the path
+    for (uint32_t i = 0; i < path->compress_sequence_count; i++) {
+        uint16_t seq_len = path->compress_sequence[i];
         
         // Validate sequence length
         if (seq_len == 0 || seq_len > SEQ_LENGTH_LIMIT) {
-            fprintf(stderr, "Warning: Skipping invalid sequence length %d at index %d\n", seq_len, i);
+            fprintf(stderr, "Warning: Skipping invalid sequence length %d at index %u\n", seq_len, i);
             continue;
         }
 
         // Check block bounds
-        if (block_index + seq_len > BLOCK_SIZE) {
-            fprintf(stderr, "Error: Sequence exceeds block bounds at index %d\n", i);
+        if (block_index + seq_len > block_size) {
+            fprintf(stderr, "Error: Sequence exceeds block bounds at index %u\n", i);
             return -1;
         }
 
-        // Extract sequence from block
-        uint8_t sequence[SEQ_LENGTH_LIMIT];
-        memcpy(sequence, block + block_index, seq_len);
-        block_index += seq_len;
-
         // Look up sequence in dictionary
-        BinarySequence* bin_seq =  NULL;//lookupSequence(sequence, seq_len);
-        if (!bin_seq) {
+        const uint8_t* sequence = block + block_index;
+        block_index += seq_len;
+        const PerfectHashSlot* slot = seq_len > 1 ? dictionary_find(dict, sequence, seq_len) : NULL;
+        if (!slot) {
             continue;  // Sequence not in dictionary
         }
 
-        // Mark as used and assign codeword
+        BinarySequence* bin_seq = &dict->entries[slot->record.entry];
+        bin_seq->count++;
         if (!bin_seq->isUsed) {
             bin_seq->isUsed = 1;
             used_count++;
-            
-            // Validate group
-            if (bin_seq->group >= TOTAL_GROUPS) {
-                fprintf(stderr, "Error: Invalid group %d for sequence\n", bin_seq->group);
-                continue;
-            }
-
-            // Get codeword size for this group
-            uint8_t code_size = groupCodeSize(bin_seq->group);
-            uint16_t max_codeword = (1 << code_size) - 1;
-            
-            // Check codeword availability
-            if (next_codeword[bin_seq->group] > max_codeword) {
-                fprintf(stderr, "Error: No more codewords available for group %d\n", bin_seq->group);
-                continue;
+            if (slot->record.group < layout->group_count) {
+                used_per_group[slot->record.group]++;
             }
-            
-            // Assign codeword
-            bin_seq->codeword = next_codeword[bin_seq->group]++;
-            
         }
     }
     
     #ifdef DEBUG
     printf("\n\n");
-    for (int k = 0; k < TOTAL_GROUPS; k++) {
-    	printf("\n group=%d, total_codewords=%d", k, next_codeword[k]); 
+    for (int k = 0; k < layout->group_count; k++) {
+    	printf("\n group=%d, used_codewords=%d", k, used_per_group[k]); 
     }	
     printf("\n\n");
+    #else
+    (void)used_per_group;
     #endif
 
-
     return used_count;
 }
 
@@ -493,32 +578,57 @@ static int calcUsedAndAssignGroupID(TreeNode *node, const uint8_t* block, uint32
   * @brief Main function to write complete compressed output file
   * 
   * @param filename Output file path
-  * @param sequences Array of binary sequences for header
-  * @param seq_count Number of sequences
-  * @param best_node TreeNode with best compression path
-  * @param raw_data Pointer to raw data block
+  * @param dict Dictionary the parse was built against
+  * @param shared True to reference dict by id instead of writing its used entries
+  * @param path Best parse of raw_data
+  * @param raw_data Pointer to raw data
+  * @param data_size Size of raw_data
+  * @return 1 on success, 0 on failure (the file may be left incomplete)
   */
-void writeCompressedOutput(const char* filename, BinarySequence** sequences, 
-                         int seq_count, TreeNode *best_node, const uint8_t* raw_data) {
-    if (!filename || !sequences || seq_count <= 0 || !best_node || !raw_data) {
+int writeCompressedOutput(const char* filename, Dictionary* dict, bool shared,
+                         const CompressPath* path, const uint8_t* raw_data, size_t data_size) {
+    if (!filename || !dict || !path || !raw_data) {
         fprintf(stderr, "Error: Invalid inputs in writeCompressedOutput\n");
-        return;
+        return 0;
     }
 
     FILE *file = fopen(filename, "wb");
     if (!file) {
         perror("Failed to open output file");
-        return;
+        return 0;
     }
     printf("\n ==== Starting compressed output writing === \n");
-	//printNode(best_node, raw_data, 0);
-    int used_count = calcUsedAndAssignGroupID(best_node, raw_data, 0);
-    writeHeaderOfCompressedFile(sequences, seq_count, used_count, file);
-    writeCompressedDataInFile(best_node, raw_data, file);
+    int used_count = 0;
+    if (!shared) {
+        used_count = calcUsedSequences(path, raw_data, data_size, dict);
+        if (used_count < 0) {
+            fclose(file);
+            return 0;
+        }
+    }
+    if (countCompressedBits(dict, shared, path, raw_data, data_size, NULL) > storedOutputSize(data_size)) {
+        // Mostly literals at LITERAL_BITS each: the parse would expand the input
+        writeStoredCopy(raw_data, data_size, file);
+    } else {
+        if (shared) {
+            // Codewords come from the shared dictionary as-is
+            writeDictionaryReference(dict->id, file);
+        } else if (!writeHeaderOfCompressedFile(dict, used_count, file)) {
+            fclose(file);
+            return 0;
+        }
+        writeCompressedDataInFile(path, raw_data, data_size, dict, file);
+    }
     printf("\n === Writing compressed output completed ==\n");
-   
+
+    // Failed fwrite calls along the way leave the error indicator set
+    int ok = !ferror(file);
+    if (!ok) {
+        fprintf(stderr, "Error: Failed to write %s\n", filename);
+    }
     if (fclose(file) != 0) {
-        perror("Warning: Error closing output file");
+        perror("Error closing output file");
+        ok = 0;
     }
+    return ok;
 }
-
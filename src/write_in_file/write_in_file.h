@@ -2,12 +2,45 @@
 #ifndef WRITE_IN_FILE_H
 #define WRITE_IN_FILE_H
 
+#include <stdbool.h>
 #include "common_types.h"
 #include "../second_pass/group.h"
-#include "../second_pass/tree_node.h"
+#include "../first_pass/dictionary.h"
 
-void writeCompressedOutput(const char* filename, BinarySequence** sequences, 
-    int seq_count, TreeNode *best_node, const uint8_t* block);
+/**
+ * Sets isUsed and count (number of tokens) of every dictionary entry from the parse.
+ * @return Number of distinct entries used, or -1 on error
+ */
+int calcUsedSequences(const CompressPath* path, const uint8_t* block, size_t block_size,
+    Dictionary* dict);
+
+// Bits of each section of a compressed file, before its byte padding
+typedef struct {
+    uint64_t header_bits;   // Count or reference, layout, entries and end marker
+    uint64_t data_bits;     // Literals and tokens
+} StreamBits;
+
+/**
+ * Counts the bits writeCompressedOutput spends on path, from the entry uses set
+ * by calcUsedSequences.
+ * @return Size of the compressed stream of path, in bytes
+ */
+uint64_t countCompressedBits(const Dictionary* dict, bool shared, const CompressPath* path,
+    const uint8_t* raw_data, size_t data_size, StreamBits* bits);
+
+// Size of a stored copy of data_size bytes: DICT_STORED_MARKER, then the bytes
+uint64_t storedOutputSize(size_t data_size);
+
+/**
+ * Writes the header and the data of a compressed file.
+ * With shared set, the header only records dict->id and the decoder must be given
+ * the same dictionary; otherwise the used entries are written into the header.
+ * When the compressed stream would be larger than a stored copy, the stored copy
+ * is written instead, so no file grows by more than its 2-byte marker.
+ * @return 1 on success, 0 if the file could not be written in full
+ */
+int writeCompressedOutput(const char* filename, Dictionary* dict, bool shared,
+    const CompressPath* path, const uint8_t* raw_data, size_t data_size);
                           
                           
 #endif
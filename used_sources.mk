@@ -6,6 +6,18 @@ SRCS = \
     src/xxhash.c \
     src/graph/graph.c \
     src/second_pass/group.c \
-    src/second_pass/prune_logic.c
+    src/second_pass/prune_logic.c \
+    src/second_pass/binseq_hashmap.c \
+    src/write_in_file/write_in_file.c \
+    src/read_file/read_file.c \
+    src/first_pass/dictionary.c \
+    src/first_pass/repair.c \
+    src/first_pass/suffix_array.c \
+    src/second_pass/aho_corasick.c \
+    src/second_pass/match_table.c \
+    src/second_pass/bloom_filter.c \
+    src/second_pass/seq_compare.c \
+    src/second_pass/select.c \
+    src/second_pass/perfect_hash.c
 
 
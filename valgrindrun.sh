@@ -1,2 +1,2 @@
 make clean && make debug
-valgrind --leak-check=full --track-origins=yes ./compress-debug tests/testSmall.txt >> 1.txt
+valgrind --leak-check=full --track-origins=yes ./compress-debug tests/testSmall.txt testSmall.tkt >> 1.txt